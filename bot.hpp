@@ -0,0 +1,745 @@
+#ifndef bot_h
+#define bot_h
+#include "lux/kit.hpp"
+#include "lux/distance_field.hpp"
+#include "lux/incremental_pathfinder.hpp"
+#include "lux/cost_grid.hpp"
+#include "lux/cooperative_planner.hpp"
+#include "lux/flow_field.hpp"
+#include "lux/bitboard_bfs.hpp"
+#include "lux/assignment.hpp"
+#include <string.h>
+#include <vector>
+#include <set>
+#include <stdio.h>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+using namespace lux;
+
+enum UnitState
+{
+  DO_NOTHING,
+  HARVEST_RESOURCE,
+  BRING_RESOURCE_BACK,
+  BUILD_CITY
+};
+
+struct UnitAction
+{
+  int unitID; // Unit::uid of the unit, -1 for an empty slot of UnitActionTable
+  UnitState state;
+  Position targetPosition;
+  vector<Position> pathToTarget;
+  int currentPathIdx;
+  /** The search behind pathToTarget, repaired rather than redone while the target stays the same */
+  IncrementalPathFinder route;
+  /** Resource cell the turn's assignment gave the unit, (-1, -1) if it got none */
+  Position assignedResource = Position(-1, -1);
+
+  UnitAction() : unitID(-1), state(DO_NOTHING), currentPathIdx(0)
+  {
+  }
+
+  /** Starts a new plan for unit ID targeting targetPosition, keeping the buffers of the path and of the route */
+  void reset(int ID, Position targetPosition)
+  {
+    unitID = ID;
+    state = DO_NOTHING;
+    this->targetPosition = targetPosition;
+    pathToTarget.clear();
+    currentPathIdx = 0;
+    route.reset();
+    assignedResource = Position(-1, -1);
+  }
+};
+
+/**
+ * The plans of a player's units, one slot per living unit found by its Unit::uid.
+ * The slots of units that are gone are handed to new units with their buffers, so the table holds as many plans
+ * as there were units at once rather than units ever built.
+ */
+class UnitActionTable
+{
+public:
+  /** The plan of a unit, nullptr if it has none yet */
+  UnitAction *find(int uid)
+  {
+    if (uid < 0 || uid >= (int)slotOfUid.size() || slotOfUid[uid] == -1)
+      return nullptr;
+    return &slots[slotOfUid[uid]];
+  }
+
+  const UnitAction *find(int uid) const
+  {
+    return const_cast<UnitActionTable *>(this)->find(uid);
+  }
+
+  /**
+   * Creates free plans up to plans, each with a path and a route that hold a map of cells cells, and room for the
+   * uids a match on such a map hands out. Units that arrive later take a ready plan, so turns allocate nothing until there are more units than plans.
+   */
+  void reserve(int plans, int cells)
+  {
+    this->cells = cells;
+    slotOfUid.reserve(Player::_idRoom(cells));
+    slots.reserve(plans);
+    freeSlots.reserve(plans);
+    alive.reserve(plans);
+    for (UnitAction &slot : slots)
+    {
+      prepare(slot);
+    }
+    while ((int)slots.size() < plans)
+    {
+      freeSlots.push_back(slots.size());
+      slots.emplace_back();
+      prepare(slots.back());
+    }
+  }
+
+  /** The plan of a unit, a new one targeting its position if it has none yet */
+  UnitAction &getOrCreate(const Unit &unit)
+  {
+    if (unit.uid >= (int)slotOfUid.size())
+      slotOfUid.resize(unit.uid + 1, -1);
+    int &slot = slotOfUid[unit.uid];
+    if (slot == -1)
+    {
+      if (freeSlots.empty())
+      {
+        slot = slots.size();
+        slots.emplace_back();
+        prepare(slots.back());
+        if (freeSlots.capacity() < slots.capacity())
+        {
+          freeSlots.reserve(slots.capacity());
+          alive.reserve(slots.capacity());
+        }
+      }
+      else
+      {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+      }
+      slots[slot].reset(unit.uid, unit.pos);
+    }
+    return slots[slot];
+  }
+
+  /** Frees the plans of the units missing from units, the living units of the player this turn */
+  void releaseMissing(const vector<Unit> &units)
+  {
+    alive.assign(slots.size(), 0);
+    for (const Unit &unit : units)
+    {
+      if (unit.uid >= 0 && unit.uid < (int)slotOfUid.size() && slotOfUid[unit.uid] != -1)
+        alive[slotOfUid[unit.uid]] = 1;
+    }
+    for (int slot = 0; slot < (int)slots.size(); slot++)
+    {
+      if (alive[slot] || slots[slot].unitID == -1)
+        continue;
+      slotOfUid[slots[slot].unitID] = -1;
+      slots[slot].unitID = -1;
+      freeSlots.push_back(slot);
+    }
+  }
+
+private:
+  /** Cells of the map the plans are sized for, 0 before reserve() */
+  int cells = 0;
+  vector<UnitAction> slots;
+  /** Slot of each Unit::uid, -1 for units without a plan */
+  vector<int> slotOfUid;
+  vector<int> freeSlots;
+  vector<char> alive;
+
+  void prepare(UnitAction &slot) const
+  {
+    slot.pathToTarget.reserve(cells);
+    slot.route.reserve(cells);
+  }
+};
+
+/** Points unitAction.pathToTarget from start to its target over costGrid priced by costs, empty if there is no way */
+void routeToTarget(UnitAction &unitAction, Position start, const CostGrid &costGrid, const CostProfile &costs)
+{
+  unitAction.route.findPath(costGrid, costs, start, unitAction.targetPosition, unitAction.pathToTarget);
+  unitAction.currentPathIdx = 0;
+}
+
+/** Points unitAction.pathToTarget from start to its target by the fewest steps through passable, empty if there is no way */
+void stepToTarget(UnitAction &unitAction, Position start, const Bitboard &passable, BitboardBFS &bfs)
+{
+  Bitboard from, target;
+  from.set(start);
+  target.set(unitAction.targetPosition);
+  bfs.compute(from, passable, target);
+  bfs.getPathToSource(unitAction.targetPosition, unitAction.pathToTarget);
+  reverse(unitAction.pathToTarget.begin(), unitAction.pathToTarget.end());
+  unitAction.currentPathIdx = 0;
+}
+
+/**
+ * Closest cell of expansions from position through passable, or the closest of sites if it is at most a couple of steps
+ * further, bfs is left holding the search from position
+ */
+Position findClosestCityExpansion(Position position, const Bitboard &expansions, const Bitboard &sites, const Bitboard &passable, BitboardBFS &bfs)
+{
+  const int detour = 2;
+  Bitboard from;
+  from.set(position);
+  bfs.compute(from, passable, expansions);
+  int closest = bfs.getDistanceTo(expansions);
+  if (closest == -1 || !sites.any())
+    return bfs.getClosest(expansions);
+  bfs.compute(from, passable, Bitboard(), closest + detour);
+  if (bfs.getDistanceTo(sites) != -1)
+    return bfs.getClosest(sites);
+  return bfs.getClosest(expansions);
+}
+
+Position findClosestCity(Position position, const FlowField &cityFlow)
+{
+  if (!cityFlow.isReachable(position))
+    return Position(-1, -1);
+  return cityFlow.getSource(position);
+}
+
+/** Sends unitAction to whichever destination of flow is cheapest from start, pathToTarget following the field */
+void followFlow(UnitAction &unitAction, Position start, const FlowField &flow)
+{
+  unitAction.targetPosition = flow.getSource(start);
+  flow.getPath(start, unitAction.pathToTarget);
+  unitAction.currentPathIdx = 0;
+}
+
+Position findClosestResource(Position position, Player &player, GameMap &map, const ResourceIndex &resourceIndex, const DistanceFields &fields, int uid, const UnitActionTable &unitActions)
+{
+  Bitboard resourcesTaken;
+  for (Unit &unit : player.units)
+  {
+    if (unit.uid == uid)
+      continue;
+
+    const UnitAction *other = unitActions.find(unit.uid);
+    if (other != nullptr && other->state == HARVEST_RESOURCE)
+      resourcesTaken.set(other->targetPosition);
+  }
+
+  // distances are weighted by type so richer fuel is worth a longer walk, unresearched types are left out
+  const int weights[ResourceIndex::TYPE_COUNT] = {3, player.researchedCoal() ? 2 : 0, player.researchedUranium() ? 1 : 0};
+  Position closest(-1, -1);
+  int closestDist = 0;
+  for (int slot = 0; slot < ResourceIndex::TYPE_COUNT; slot++)
+  {
+    const DistanceField &field = fields.get((FIELD_TARGETS)(WOOD_CELLS + slot));
+    if (weights[slot] == 0 || !field.isReachable(position))
+      continue;
+    int dist = field.getDistance(position) * weights[slot];
+    if (closest.x == -1 || dist < closestDist)
+    {
+      closest = field.getSource(position);
+      closestDist = dist;
+    }
+  }
+  if (closest.x != -1 && !resourcesTaken.test(closest))
+    return closest;
+  // the closest cell is someone else's target, settle for the closest free one by steps, not as the crow flies
+  const DistanceTable &table = fields.getTable();
+  return resourceIndex.findNearest(position, map, weights, fields.minResourceAmount, resourcesTaken, [&](int x, int y)
+                                   { return table.get(position, Position(x, y)); });
+}
+
+bool startHarvestResource(Unit &unit, UnitAction &unitAction, GameMap &gameMap, const CostGrid &costGrid, const CostProfile &costs, kit::ActionList &actions, Player &player, const ResourceIndex &resourceIndex, const DistanceFields &fields, UnitActionTable &unitActions, ostream &debug)
+{
+  Position selectedPosition = unitAction.assignedResource.x != -1 ? unitAction.assignedResource : findClosestResource(unit.pos, player, gameMap, resourceIndex, fields, unit.uid, unitActions);
+  if (selectedPosition.x != -1 && selectedPosition.y != -1)
+  {
+    unitAction.state = HARVEST_RESOURCE;
+    unitAction.targetPosition = selectedPosition;
+    routeToTarget(unitAction, unit.pos, costGrid, costs);
+    actions.emplace_back(Annotate::text(selectedPosition.x, selectedPosition.y, "Collect Resource"));
+    debug << "Collect Resources : " << unitAction.pathToTarget.size() << std::endl;
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+bool startBringBackResource(Unit &unit, UnitAction &unitAction, const FlowField &cityFlow, kit::ActionList &actions, ostream &debug)
+{
+  Position selectedPosition = findClosestCity(unit.pos, cityFlow);
+  if (selectedPosition.x != -1 && selectedPosition.y != -1)
+  {
+    unitAction.state = BRING_RESOURCE_BACK;
+    followFlow(unitAction, unit.pos, cityFlow);
+    actions.emplace_back(Annotate::text(selectedPosition.x, selectedPosition.y, "Bring back resources"));
+    debug << "Bring back resources : " << unitAction.pathToTarget.size() << std::endl;
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+bool startExpandingCity(Unit &unit, UnitAction &unitAction, const Bitboard &sites, const Bitboard &passable, BitboardBFS &bfs, kit::ActionList &actions, const DistanceFields &fields, ostream &debug)
+{
+  Position selectedPosition = findClosestCityExpansion(unit.pos, fields.expansions, sites, passable, bfs);
+  if (selectedPosition.x != -1 && selectedPosition.y != -1)
+  {
+    unitAction.state = BUILD_CITY;
+    unitAction.targetPosition = selectedPosition;
+    bfs.getPathToSource(selectedPosition, unitAction.pathToTarget);
+    reverse(unitAction.pathToTarget.begin(), unitAction.pathToTarget.end());
+    unitAction.currentPathIdx = 0;
+    actions.emplace_back(Annotate::text(selectedPosition.x, selectedPosition.y, "Build city"));
+    debug << "Build city : " << unitAction.pathToTarget.size() << std::endl;
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+/** The strategy, keeps its per-unit plans between turns */
+class Bot
+{
+public:
+  /**
+   * Plans sized up front for our units, well above the 152 units a team reached at most in self-play on 32 x 32 maps.
+   * Each holds a route and a path over the whole map, about 40 KB there.
+   */
+  static constexpr int RESERVED_PLANS = 256;
+
+  /** debug receives the strategy's trace, standard output by default as the CLI shows it in the replay */
+  Bot(ostream &debug = cout) : debug(debug)
+  {
+  }
+
+  /** Plays one turn on the state decoded by gameState.update() and appends the commands to actions */
+  void playTurn(kit::Agent &gameState, kit::ActionList &actions)
+  {
+    if (!initializedUnits)
+    {
+      initializedUnits = true;
+      reserve(gameState.id, gameState.map.width * gameState.map.height);
+
+      for (int player = 0; player < 2; player++)
+      {
+        for (const Unit &unit : gameState.players[player].units)
+        {
+          allActions[player].getOrCreate(unit);
+        }
+      }
+    }
+
+    Player &player = gameState.players[gameState.id];
+    Player &opponent = gameState.players[(gameState.id + 1) % 2];
+    for (int team = 0; team < 2; team++)
+    {
+      allActions[team].releaseMissing(gameState.players[team].units);
+    }
+
+    bool isDay = gameState.turn % GAME_PARAMETERS.getCycleLength() <= 25;
+
+    UnitActionTable &playerUnitActions = allActions[gameState.id];
+
+    GameMap &gameMap = gameState.map;
+
+    // how many of our units will stand on each cell once this turn's moves are applied, updated as moves are decided
+    unitsOnCell.assign(gameMap.width * gameMap.height, 0);
+    for (Unit &unit : player.units)
+    {
+      unitsOnCell[gameMap.getIndex(unit.pos.x, unit.pos.y)]++;
+    }
+
+    fields.update(gameMap, gameState.bitboards, player.team);
+    costGrid.build(gameMap, gameState.bitboards, player.team);
+    cityFlow.compute(costGrid, walkCosts, gameState.bitboards.citytiles[player.team]);
+    builderPassable = Bitboard::full(gameMap.width, gameMap.height).andNot(gameState.bitboards.citytiles[0] | gameState.bitboards.citytiles[1]);
+    collectBuildSites(gameState.clusters, player);
+    planner.reset(costGrid);
+    assignHarvesters(gameMap, gameState.clusters, player, playerUnitActions, isDay);
+    movers.clear();
+
+    // we iterate over all our units and do something with them
+    for (int i = 0; i < player.units.size(); i++)
+    {
+      Unit unit = player.units[i];
+      UnitAction &unitAction = playerUnitActions.getOrCreate(unit);
+      // keeps its cell from the units planned before it
+      planner.hold(costGrid, unit.uid, unit.pos, 0, 1);
+
+      for (int pathIdx = 0; pathIdx < unitAction.pathToTarget.size(); pathIdx++)
+      {
+        if (unitAction.pathToTarget[pathIdx] == unit.pos)
+        {
+          unitAction.currentPathIdx = pathIdx;
+          break;
+        }
+      }
+
+      if (unitAction.pathToTarget.size() > 2)
+      {
+        for (int pathIdx = unitAction.currentPathIdx; pathIdx < unitAction.pathToTarget.size() - 1; pathIdx++)
+        {
+          debug << pathIdx << std::endl;
+          actions.emplace_back(Annotate::line(unitAction.pathToTarget[pathIdx].x, unitAction.pathToTarget[pathIdx].y,
+                                           unitAction.pathToTarget[pathIdx + 1].x, unitAction.pathToTarget[pathIdx + 1].y));
+        }
+      }
+
+      if (unit.isWorker() && unit.canAct())
+      {
+        debug << "================" << std::endl;
+        debug << "Unit " << i << std::endl;
+        debug << unitAction.state << std::endl;
+        debug << unitAction.currentPathIdx << " for a path size of " << unitAction.pathToTarget.size() << std::endl;
+
+        if (unitAction.state == HARVEST_RESOURCE)
+        {
+          debug << "Harvest : " << (GAME_PARAMETERS.RESOURCE_CAPACITY.WORKER - unit.getCargoSpaceLeft()) << "/" << (GAME_PARAMETERS.RESOURCE_CAPACITY.WORKER - (isDay ? 0 : 25)) << std::endl;
+          debug << "Harvest (Space Left) : " << unit.getCargoSpaceLeft() << " <= " << (isDay ? 0 : 25) << std::endl;
+          if (unit.getCargoSpaceLeft() <= (isDay ? 0 : 25))
+          {
+            Position newPos = findClosestCity(unit.pos, cityFlow);
+            City *city = newPos.x != -1 ? player.getCity(gameMap.getCell(newPos.x, newPos.y).citytile) : nullptr;
+            if (isDay && city != nullptr && city->fuel > city->lightUpkeep * 10)
+            {
+              // Expand city
+              if (!startExpandingCity(unit, unitAction, buildSites, builderPassable, bfs, actions, fields, debug))
+              {
+                if (!startBringBackResource(unit, unitAction, cityFlow, actions, debug))
+                {
+                  unitAction.state = DO_NOTHING;
+                }
+              }
+            }
+            else
+            {
+              // Bring back resources
+              if (!startBringBackResource(unit, unitAction, cityFlow, actions, debug))
+              {
+                unitAction.state = DO_NOTHING;
+              }
+            }
+          }
+          else
+          {
+            // Check if target resource still exists and is still ours
+            Cell cell = gameMap.getCell(unitAction.targetPosition.x, unitAction.targetPosition.y);
+            bool reassigned = unitAction.assignedResource.x != -1 && unitAction.assignedResource != unitAction.targetPosition;
+            if (!cell.hasResource() || cell.resource.amount < 10 || reassigned)
+            {
+              if (!startHarvestResource(unit, unitAction, gameMap, costGrid, walkCosts, actions, player, gameState.resourceIndex, fields, playerUnitActions, debug))
+              {
+                unitAction.state = DO_NOTHING;
+              }
+            }
+          }
+        }
+        else if (unitAction.state == BRING_RESOURCE_BACK)
+        {
+          CityTile *citytile = player.getCityTile(gameMap.getCell(unitAction.targetPosition.x, unitAction.targetPosition.y).citytile);
+          if (citytile == nullptr || unit.getCargoSpaceLeft() > 0)
+          {
+            // Go Harvest / Do something else
+
+            if (citytile == nullptr && !startBringBackResource(unit, unitAction, cityFlow, actions, debug))
+            {
+              unitAction.state = DO_NOTHING;
+            }
+            else if (unit.getCargoSpaceLeft() > 0 && !startHarvestResource(unit, unitAction, gameMap, costGrid, walkCosts, actions, player, gameState.resourceIndex, fields, playerUnitActions, debug))
+            {
+              unitAction.state = DO_NOTHING;
+            }
+          }
+        }
+        else if (unitAction.state == BUILD_CITY)
+        {
+          if (unit.pos.distanceTo(unitAction.targetPosition) == 0 && unit.canBuild(gameMap))
+          {
+            actions.emplace_back(unit.buildCity());
+            unitAction.state = DO_NOTHING;
+            planner.hold(costGrid, unit.uid, unit.pos, 0, CooperativePlanner::WINDOW);
+            continue;
+          }
+          else if (gameMap.getCellByPos(unitAction.targetPosition).citytile.isValid() || unit.getCargoSpaceLeft() > 0)
+          {
+            unitAction.state = DO_NOTHING;
+            planner.hold(costGrid, unit.uid, unit.pos, 0, CooperativePlanner::WINDOW);
+            continue;
+          }
+        }
+
+        if (unitAction.state == BRING_RESOURCE_BACK)
+        {
+          if (cityFlow.isReachable(unit.pos))
+            followFlow(unitAction, unit.pos, cityFlow);
+        }
+        else if (unitAction.state == BUILD_CITY)
+        {
+          stepToTarget(unitAction, unit.pos, builderPassable, bfs);
+        }
+        else if (unitAction.state != DO_NOTHING)
+        {
+          // the cells that changed since the route was last asked for may have opened a shorter way or closed this one
+          routeToTarget(unitAction, unit.pos, costGrid, walkCosts);
+        }
+
+        if (unitAction.pathToTarget.size() == 0)
+        {
+          actions.emplace_back(Annotate::text(unit.pos.x, unit.pos.y, "No Pathfinding"));
+        }
+        else
+        {
+          debug << "Current Pathing : " << std::endl;
+          debug << "Idx : " << unitAction.currentPathIdx << std::endl;
+          for (int pathId = 0; pathId < unitAction.pathToTarget.size(); pathId++)
+          {
+            debug << unitAction.pathToTarget[pathId].x << " " << unitAction.pathToTarget[pathId].y << std::endl;
+          }
+        }
+
+        debug << "Position : " << unit.pos.x << " " << unit.pos.y << std::endl;
+        debug << "Target : " << unitAction.targetPosition.x << " " << unitAction.targetPosition.y << std::endl;
+
+        if (unitAction.state == DO_NOTHING)
+        {
+          if (!startBringBackResource(unit, unitAction, cityFlow, actions, debug))
+          {
+            unitAction.state = DO_NOTHING;
+          }
+        }
+
+        if (unitAction.state != DO_NOTHING)
+        {
+          movers.push_back(i);
+          continue;
+        }
+      }
+      // stays where it is, until it can act again if it is cooling down
+      planner.hold(costGrid, unit.uid, unit.pos, 0, unit.canAct() ? CooperativePlanner::WINDOW : (int)ceil(unit.cooldown));
+    }
+
+    planMoves(gameMap, player, playerUnitActions, actions);
+
+    // Update cities, a new worker needs a free tile and a city tile for each unit
+    int unitCount = player.units.size();
+    for (City &city : player.cities)
+    {
+      for (CityTile &citytile : city.citytiles)
+      {
+        if (citytile.canAct())
+        {
+          if (player.cityTileCount > unitCount && !gameState.bitboards.units[player.team].test(citytile.pos))
+          {
+            actions.emplace_back(citytile.buildWorker());
+            unitCount++;
+          }
+          else
+          {
+            actions.emplace_back(citytile.research());
+          }
+        }
+      }
+    }
+  }
+
+private:
+  ostream &debug;
+  bool initializedUnits = false;
+  UnitActionTable allActions[2];
+  vector<int> unitsOnCell;
+  DistanceFields fields;
+  CostGrid costGrid;
+  /** The way back to our closest city tile from every cell, shared by every unit bringing resources back */
+  FlowField cityFlow;
+  /**
+   * Builders walk around every city tile, since stepping on one of ours drops the cargo, so their short trips
+   * to an expansion are counted in steps on a bitboard rather than priced on costGrid
+   */
+  Bitboard builderPassable;
+  /** Expansions next to a resource cluster we can collect from */
+  Bitboard buildSites;
+  BitboardBFS bfs;
+  CooperativePlanner planner;
+  MinCostAssignment harvestAssignment;
+  /** Unit uids, their positions and the resource cell indices of this turn's assignment */
+  vector<int> harvesters;
+  vector<Position> harvesterPositions;
+  vector<int> resourceCells;
+  /** Indices in Player::units of the workers that move this turn */
+  vector<int> movers;
+  vector<Position> steps;
+  /**
+   * Our other units are left to the cooperative planner's reservations, so they do not move the prices of the routes.
+   * A builder goes around our city tiles since stepping on one drops its cargo.
+   */
+  const CostProfile walkCosts = CostProfile(GAME_PARAMETERS.UNIT_ACTION_COOLDOWN.WORKER, 0, 0);
+  const CostProfile buildCosts = CostProfile(GAME_PARAMETERS.UNIT_ACTION_COOLDOWN.WORKER, 0, 100);
+
+  /** Sizes the plans and the buffers of a turn once for a map of cells cells, so turns on it do not allocate */
+  void reserve(int team, int cells)
+  {
+    int plans = min(cells, RESERVED_PLANS);
+    allActions[team].reserve(plans, cells);
+    harvestAssignment.reserve(plans, cells, Player::_idRoom(cells), cells);
+    harvesters.reserve(plans);
+    harvesterPositions.reserve(plans);
+    resourceCells.reserve(cells);
+    movers.reserve(plans);
+    steps.reserve(cells);
+  }
+
+  void collectBuildSites(const ResourceClusters &clusters, Player &player)
+  {
+    buildSites.clear();
+    for (int id : clusters.getIds())
+    {
+      const ResourceCluster &cluster = clusters.get(id);
+      if (cluster.type == ResourceType::wood || (cluster.type == ResourceType::coal && player.researchedCoal()) || (cluster.type == ResourceType::uranium && player.researchedUranium()))
+        buildSites |= cluster.perimeter;
+    }
+    buildSites &= fields.expansions;
+  }
+
+  /** Whether unit will be looking for a resource cell this turn once its state is updated */
+  static bool willHarvest(const Unit &unit, const UnitAction &unitAction, bool isDay)
+  {
+    if (!unit.isWorker())
+      return false;
+    if (unitAction.state == HARVEST_RESOURCE)
+      return unit.getCargoSpaceLeft() > (isDay ? 0 : 25);
+    return unitAction.state == BRING_RESOURCE_BACK && unit.getCargoSpaceLeft() > 0;
+  }
+
+  /**
+   * Gives the workers that will be harvesting distinct resource cells at the least total cost, in UnitAction::assignedResource.
+   * A cell costs the steps to it, plus one for the turns spent there, per unit of fuel it yields a turn, so richer fuel
+   * is worth a longer walk. Starts from last turn's assignment, so units only change cells when it pays.
+   */
+  void assignHarvesters(const GameMap &gameMap, ResourceClusters &clusters, Player &player, UnitActionTable &playerUnitActions, bool isDay)
+  {
+    harvesters.clear();
+    harvesterPositions.clear();
+    for (Unit &unit : player.units)
+    {
+      UnitAction &unitAction = playerUnitActions.getOrCreate(unit);
+      unitAction.assignedResource = Position(-1, -1);
+      if (willHarvest(unit, unitAction, isDay))
+      {
+        harvesters.push_back(unit.uid);
+        harvesterPositions.push_back(unit.pos);
+      }
+    }
+
+    // cost of one step towards a cell of each type, by how much fuel a worker collects there per turn
+    const int fuelPerTurn[ResourceIndex::TYPE_COUNT] = {
+        GAME_PARAMETERS.WORKER_COLLECTION_RATE.WOOD * GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.WOOD,
+        player.researchedCoal() ? GAME_PARAMETERS.WORKER_COLLECTION_RATE.COAL * GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.COAL : 0,
+        player.researchedUranium() ? GAME_PARAMETERS.WORKER_COLLECTION_RATE.URANIUM * GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.URANIUM : 0};
+    resourceCells.clear();
+    clusters.clearUnits();
+    for (int id : clusters.getIds())
+    {
+      if (fuelPerTurn[ResourceIndex::getTypeSlot(clusters.get(id).type)] == 0)
+        continue;
+      clusters.forEachCell(id, [&](int idx)
+                           {
+                             if (gameMap.resourceAmount[idx] > fields.minResourceAmount)
+                               resourceCells.push_back(idx); });
+    }
+    if (harvesters.empty() || resourceCells.empty())
+      return;
+
+    const DistanceTable &table = fields.getTable();
+    harvestAssignment.solve(harvesters, resourceCells, [&](int i, int j)
+                            {
+                              Position cell(resourceCells[j] % gameMap.width, resourceCells[j] / gameMap.width);
+                              int steps = table.get(harvesterPositions[i], cell);
+                              if (steps < 0)
+                                return (int)MinCostAssignment::NO_COLUMN_COST;
+                              return (steps + 1) * 1000 / fuelPerTurn[ResourceIndex::getTypeSlot(gameMap.resourceType[resourceCells[j]])]; });
+    for (int i = 0; i < (int)harvesters.size(); i++)
+    {
+      int j = harvestAssignment.getColumn(i);
+      if (j == -1)
+        continue;
+      Position cell(resourceCells[j] % gameMap.width, resourceCells[j] / gameMap.width);
+      playerUnitActions.find(harvesters[i])->assignedResource = cell;
+      clusters.assignUnit(harvesters[i], cell);
+    }
+  }
+
+  /**
+   * Plans the movers in one pass, units bringing resources back first, then builders, then harvesters, the oldest first
+   * within each group. Every plan avoids the cells reserved by the ones before it, so the moves cannot collide.
+   */
+  void planMoves(const GameMap &gameMap, Player &player, UnitActionTable &playerUnitActions, kit::ActionList &actions)
+  {
+    auto priority = [&](int index)
+    {
+      switch (playerUnitActions.find(player.units[index].uid)->state)
+      {
+      case BRING_RESOURCE_BACK:
+        return 0;
+      case BUILD_CITY:
+        return 1;
+      default:
+        return 2;
+      }
+    };
+    sort(movers.begin(), movers.end(), [&](int a, int b)
+         { return priority(a) != priority(b) ? priority(a) < priority(b) : player.units[a].uid < player.units[b].uid; });
+
+    for (int index : movers)
+    {
+      const Unit &unit = player.units[index];
+      UnitAction &unitAction = *playerUnitActions.find(unit.uid);
+      const CostProfile &costs = unitAction.state == BUILD_CITY ? buildCosts : walkCosts;
+      DIRECTIONS dir = unitAction.state == BRING_RESOURCE_BACK && cityFlow.isReachable(unit.pos)
+                           ? planner.plan(costGrid, costs, GAME_PARAMETERS.UNIT_ACTION_COOLDOWN.WORKER, unit.uid, unit.pos, cityFlow, steps)
+                           : planner.plan(costGrid, costs, GAME_PARAMETERS.UNIT_ACTION_COOLDOWN.WORKER, unit.uid, unit.pos, unitAction.targetPosition, steps);
+      if (dir == CENTER)
+        continue;
+
+      Position next = unit.pos.translate(dir, 1);
+      debug << "Moving to : " << next.x << " " << next.y << std::endl;
+      actions.emplace_back(unit.move(dir));
+      moveUnit(gameMap, unit.pos, next);
+      if (unitAction.currentPathIdx + 1 < (int)unitAction.pathToTarget.size() && unitAction.pathToTarget[unitAction.currentPathIdx + 1] == next)
+      {
+        unitAction.currentPathIdx++;
+      }
+      else
+      {
+        // stepped aside to let someone through, the way on starts from the new cell
+        if (unitAction.state == BRING_RESOURCE_BACK && cityFlow.isReachable(next))
+          followFlow(unitAction, next, cityFlow);
+        else if (unitAction.state == BUILD_CITY)
+          stepToTarget(unitAction, next, builderPassable, bfs);
+        else
+          routeToTarget(unitAction, next, costGrid, costs);
+      }
+    }
+  }
+
+  /** Moves one of our units on costGrid, a cell stays occupied while other units share it */
+  void moveUnit(const GameMap &gameMap, const Position &from, const Position &to)
+  {
+    if (--unitsOnCell[gameMap.getIndex(from.x, from.y)] == 0)
+      costGrid.setOwnUnit(from, false);
+    unitsOnCell[gameMap.getIndex(to.x, to.y)]++;
+    costGrid.setOwnUnit(to, true);
+  }
+};
+
+#endif
@@ -30,7 +30,7 @@ compile () {
 
 setup
 if [ $# -eq 0 ]; then
-  compile main.cpp -O3 -std=c++11 -o main.out
+  compile main.cpp -O3 -std=c++17 -o main.out
 else
   compile $@
 fi
@@ -39,4 +39,18 @@ fi
 
 # test bot
 # kaggle-environments run --environment lux_ai_2021 --agents bot/main.py bot/main.py --render '{"mode": "json"}' --configuration '{"seed": 0}' --out out.json --debug=True
-# docker cp test:/usr/src/app/kaggle_environments/out.json out.json
\ No newline at end of file
+# docker cp test:/usr/src/app/kaggle_environments/out.json out.json
+# playback a recording made with LUX_RECORD=<prefix> (writes <prefix>_<agent id>.rec)
+# ./compile.sh playback.cpp -O3 -std=c++17 -o playback.out && ./playback.out <prefix>_0.rec
+# with -DLUX_COUNT_ALLOCATIONS it fails when a turn from 180 on calls operator new
+# ./compile.sh playback.cpp -O3 -std=c++17 -DLUX_COUNT_ALLOCATIONS -o playback.out && ./playback.out <prefix>_0.rec
+# rule variants: build with -DLUX_RUNTIME_PARAMETERS and run with LUX_PARAMETERS=<file shaped like lux/game_constants.json>
+# ./compile.sh main.cpp -O3 -std=c++17 -DLUX_RUNTIME_PARAMETERS -o main.out
+# check lux/simulator.hpp against a CLI match: record an agent with LUX_RECORD=<prefix> and keep the replay written by --out
+# ./compile.sh simcheck.cpp -O3 -std=c++17 -o simcheck.out && ./simcheck.out <prefix>_0.rec replay.json
+# or against the rule cases worked out by hand from the published rules
+# ./compile.sh simcheck.cpp -O3 -std=c++17 -o simcheck.out && ./simcheck.out simcheck_cases.txt
+# self-play the strategy over lux/simulator.hpp: selfplay.out [games] [threads] [first seed] [map size]
+# ./compile.sh selfplay.cpp -O3 -std=c++17 -pthread -o selfplay.out && ./selfplay.out 1000
+# check lux/snapshot.hpp on self-play states: snapcheck.out [games] [first seed], -DLUX_COUNT_ALLOCATIONS also checks restores and late steps allocate nothing
+# ./compile.sh snapcheck.cpp -O3 -std=c++17 -DLUX_COUNT_ALLOCATIONS -o snapcheck.out && ./snapcheck.out 8
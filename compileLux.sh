@@ -1,2 +1,2 @@
-g++ main.cpp -O3 -std=c++11 -o main.out
+g++ main.cpp -O3 -std=c++17 -o main.out
 lux-ai-2021 main.out main.out --out=replay.json
\ No newline at end of file
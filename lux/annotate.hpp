@@ -1,6 +1,7 @@
 #ifndef annotate_h
 #define annotate_h
-#include <string>
+#include <string_view>
+#include "command.hpp"
 
 namespace lux
 {
@@ -9,34 +10,34 @@ namespace lux
   class Annotate
   {
     public:
-    static string circle(int x, int y)
+    static Command circle(int x, int y)
     {
-      return "dc " + to_string(x) + " " + to_string(y);
+      return Command() << "dc " << x << " " << y;
     }
 
-    static string x(int x, int y)
+    static Command x(int x, int y)
     {
-      return "dx " + to_string(x) + " " + to_string(y);
+      return Command() << "dx " << x << " " << y;
     }
 
-    static string line(int x1, int y1, int x2, int y2)
+    static Command line(int x1, int y1, int x2, int y2)
     {
-      return "dl " + to_string(x1) + " " + to_string(y1) + " " +  to_string(x2) + " " + to_string(y2);
+      return Command() << "dl " << x1 << " " << y1 << " " << x2 << " " << y2;
     }
 
-    static string text(int x1, int y1, string message)
+    static Command text(int x1, int y1, string_view message)
     {
-      return "dt " + to_string(x1) + " " + to_string(y1) + " '" +  message + "' 16";
+      return Command() << "dt " << x1 << " " << y1 << " '" << message << "' 16";
     }
 
-    static string text(int x1, int y1, string message, int fontsize)
+    static Command text(int x1, int y1, string_view message, int fontsize)
     {
-      return "dt " + to_string(x1) + " " + to_string(y1) + " '" +  message + "' " + to_string(fontsize);
+      return Command() << "dt " << x1 << " " << y1 << " '" << message << "' " << fontsize;
     }
 
-    static string sidetext(string message)
+    static Command sidetext(string_view message)
     {
-      return "dst '" + message + "'";
+      return Command() << "dst '" << message << "'";
     }
   };
 }
@@ -0,0 +1,96 @@
+#ifndef arena_h
+#define arena_h
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace kit
+{
+    using namespace std;
+
+    /**
+     * Number of calls to the global operator new so far.
+     * Only counted when the binary is built with LUX_COUNT_ALLOCATIONS, see define.cpp.
+     */
+    inline atomic<size_t> allocationCount{0};
+
+    /**
+     * Monotonic memory for the commands of one turn, owned by kit::Agent and reset by update(); the strategy's own
+     * per-turn buffers are sized once per map and kept instead, see Bot::reserve().
+     * Allocations are pointer bumps into one buffer that is reused every turn. A turn that runs past the buffer
+     * falls back to the heap and the buffer is grown at the next reset, so steady-state turns never reach operator new.
+     */
+    class TurnArena
+    {
+    public:
+        /** Room for a few hundred commands, more than the units and city tiles of a team act in one turn */
+        static constexpr size_t INITIAL_SIZE = 1 << 17;
+
+        TurnArena() : buffer(INITIAL_SIZE)
+        {
+            arena.emplace(buffer.data(), buffer.size(), &upstream);
+        }
+
+        TurnArena(const TurnArena &) = delete;
+        TurnArena &operator=(const TurnArena &) = delete;
+
+        /** Frees everything allocated since the last reset */
+        void reset()
+        {
+            arena.reset();
+            if (upstream.allocated > 0)
+            {
+                buffer = vector<std::byte>(2 * (buffer.size() + upstream.allocated));
+                upstream.allocated = 0;
+            }
+            arena.emplace(buffer.data(), buffer.size(), &upstream);
+        }
+
+        pmr::memory_resource *resource()
+        {
+            return &*arena;
+        }
+
+        size_t capacity() const
+        {
+            return buffer.size();
+        }
+
+    private:
+        /** The heap behind the arena, remembers how much the current turn needed beyond the buffer */
+        class Overflow : public pmr::memory_resource
+        {
+        public:
+            size_t allocated = 0;
+
+        protected:
+            void *do_allocate(size_t bytes, size_t alignment) override
+            {
+                allocated += bytes;
+                return pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void *p, size_t bytes, size_t alignment) override
+            {
+                pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            }
+
+            bool do_is_equal(const pmr::memory_resource &other) const noexcept override
+            {
+                return this == &other;
+            }
+        };
+
+        vector<std::byte> buffer;
+        Overflow upstream;
+        optional<pmr::monotonic_buffer_resource> arena;
+    };
+
+    /** Commands of one turn, allocated in the turn's arena */
+    using ActionList = pmr::vector<pmr::string>;
+}
+
+#endif
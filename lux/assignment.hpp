@@ -0,0 +1,291 @@
+#ifndef assignment_h
+#define assignment_h
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * Minimum-cost assignment of rows to distinct columns, every row getting one, by shortest augmenting paths with
+     * row and column prices (the Hungarian method).
+     * Rows and columns carry keys that stay the same from one solve to the next, say unit and cell ids. A solve starts
+     * from the previous one: each row keeps its last column as long as that is still a cheapest choice at the old
+     * column prices, and only the rows that lost theirs are augmented again.
+     */
+    class MinCostAssignment
+    {
+    public:
+        /** Cost of leaving a row without a real column, anything at or above it counts as no way */
+        static constexpr int NO_COLUMN_COST = 1 << 20;
+
+        /**
+         * Assigns every row i, keyed rowKeys[i], to a column j, keyed columnKeys[j], at total cost(i, j) as low as can be.
+         * Keys must be non-negative. When there are more rows than columns some rows get no column, see getColumn().
+         */
+        template <class Cost>
+        void solve(const vector<int> &rowKeys, const vector<int> &columnKeys, Cost cost)
+        {
+            augmented = 0;
+            rows = rowKeys.size();
+            realColumns = columnKeys.size();
+            columns = max(realColumns, rows);
+            fillGrowing(costs, rows * columns, 0);
+            for (int i = 0; i < rows; i++)
+            {
+                for (int j = 0; j < columns; j++)
+                {
+                    costs[i * columns + j] = j < realColumns ? min(cost(i, j), (int)NO_COLUMN_COST) : NO_COLUMN_COST;
+                }
+            }
+
+            // 1-based as in the classic formulation: column 0 is where each augmenting path starts
+            fillGrowing(rowPrice, rows + 1, 0);
+            fillGrowing(columnPrice, columns + 1, 0);
+            fillGrowing(columnRow, columns + 1, 0);
+            warmStart(rowKeys, columnKeys);
+            for (int i = 1; i <= rows; i++)
+            {
+                if (rowColumn(i) == 0)
+                    augment(i);
+            }
+
+            fillGrowing(assigned, rows, -1);
+            for (int j = 1; j <= columns; j++)
+            {
+                int i = columnRow[j];
+                if (i != 0 && j <= realColumns && costs[(i - 1) * columns + j - 1] < NO_COLUMN_COST)
+                    assigned[i - 1] = j - 1;
+            }
+            remember(rowKeys, columnKeys);
+        }
+
+        /**
+         * Makes room for solves of up to rows rows and columns columns, whose row keys stay below rowKeys and column
+         * keys below columnKeys, so such solves allocate nothing
+         */
+        void reserve(int rows, int columns, int rowKeys, int columnKeys)
+        {
+            columns = max(columns, rows);
+            costs.reserve(rows * columns);
+            rowPrice.reserve(rows + 1);
+            held.reserve(rows + 1);
+            assigned.reserve(rows);
+            columnPrice.reserve(columns + 1);
+            columnRow.reserve(columns + 1);
+            minSlack.reserve(columns + 1);
+            previous.reserve(columns + 1);
+            used.reserve(columns + 1);
+            lastColumnKey.reserve(rowKeys);
+            lastPrice.reserve(columnKeys);
+            lastPriced.reserve(columnKeys);
+            columnOfKey.reserve(columnKeys);
+        }
+
+        /** Column of row i in the last solve, -1 if it got none */
+        int getColumn(int i) const
+        {
+            return assigned[i];
+        }
+
+        /** Number of rows the last solve had to augment, those that could not keep their previous column */
+        int getAugmentedCount() const
+        {
+            return augmented;
+        }
+
+    private:
+        static constexpr int INF = INT_MAX / 2;
+
+        int rows = 0;
+        int columns = 0;
+        int realColumns = 0;
+        int augmented = 0;
+        vector<int> costs;
+        vector<int> rowPrice;
+        vector<int> columnPrice;
+        /** 1-based row holding each 1-based column, 0 if free */
+        vector<int> columnRow;
+        vector<int> assigned;
+        /** Scratch for warmStart() and augment() */
+        vector<int> held;
+        vector<int> minSlack;
+        vector<int> previous;
+        vector<char> used;
+        /** What the last solve left, by key: the column key each row key held and the price of each column key */
+        vector<int> lastColumnKey;
+        vector<int> lastPrice;
+        vector<char> lastPriced;
+        /** 1-based column of each column key in the current solve, 0 if absent */
+        vector<int> columnOfKey;
+
+        /** v.assign(n, value), reserving half as much again when v has to grow, so a solve a row larger than the last seldom allocates */
+        template <class T>
+        static void fillGrowing(vector<T> &v, int n, T value)
+        {
+            if ((int)v.capacity() < n)
+                v.reserve(n + n / 2);
+            v.assign(n, value);
+        }
+
+        int cost(int i, int j) const
+        {
+            return costs[(i - 1) * columns + j - 1];
+        }
+
+        int rowColumn(int i) const
+        {
+            for (int j = 1; j <= columns; j++)
+            {
+                if (columnRow[j] == i)
+                    return j;
+            }
+            return 0;
+        }
+
+        /**
+         * Rows take back their last column at its last price. Prices have to stay at most zero, and zero on free
+         * columns, with every reduced cost non-negative and zero on the kept pairs, so rows whose column is no longer
+         * a cheapest one let it go, which frees it and may undo others, until everything holds.
+         */
+        void warmStart(const vector<int> &rowKeys, const vector<int> &columnKeys)
+        {
+            for (int j = 0; j < realColumns; j++)
+            {
+                int key = columnKeys[j];
+                if (key >= (int)columnOfKey.size())
+                    columnOfKey.resize(key + 1, 0);
+                columnOfKey[key] = j + 1;
+            }
+            for (int i = 0; i < rows; i++)
+            {
+                int key = rowKeys[i];
+                if (key >= (int)lastColumnKey.size() || lastColumnKey[key] == -1)
+                    continue;
+                int columnKey = lastColumnKey[key];
+                if (columnKey >= (int)columnOfKey.size() || columnOfKey[columnKey] == 0)
+                    continue;
+                int j = columnOfKey[columnKey];
+                if (columnRow[j] == 0 && costs[i * columns + j - 1] < NO_COLUMN_COST)
+                {
+                    columnRow[j] = i + 1;
+                    if (columnKey < (int)lastPriced.size() && lastPriced[columnKey])
+                        columnPrice[j] = min(0, lastPrice[columnKey]);
+                }
+            }
+            for (int j = 0; j < realColumns; j++)
+            {
+                columnOfKey[columnKeys[j]] = 0;
+            }
+
+            fillGrowing(held, rows + 1, 0);
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                for (int j = 1; j <= columns; j++)
+                {
+                    if (columnRow[j] != 0)
+                        held[columnRow[j]] = j;
+                }
+                for (int i = 1; i <= rows; i++)
+                {
+                    int best = INF;
+                    for (int j = 1; j <= columns; j++)
+                    {
+                        best = min(best, cost(i, j) - columnPrice[j]);
+                    }
+                    rowPrice[i] = best;
+                }
+                for (int i = 1; i <= rows; i++)
+                {
+                    int j = held[i];
+                    if (j != 0 && columnRow[j] == i && cost(i, j) - rowPrice[i] - columnPrice[j] != 0)
+                    {
+                        columnRow[j] = 0;
+                        columnPrice[j] = 0;
+                        held[i] = 0;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        /** Gives row i a column along a cheapest alternating path, adjusting prices so every reduced cost stays non-negative */
+        void augment(int i)
+        {
+            augmented++;
+            fillGrowing(minSlack, columns + 1, INF);
+            fillGrowing(previous, columns + 1, 0);
+            fillGrowing(used, columns + 1, (char)0);
+            columnRow[0] = i;
+            int j0 = 0;
+            do
+            {
+                used[j0] = 1;
+                int i0 = columnRow[j0], delta = INF, j1 = 0;
+                for (int j = 1; j <= columns; j++)
+                {
+                    if (used[j])
+                        continue;
+                    int slack = cost(i0, j) - rowPrice[i0] - columnPrice[j];
+                    if (slack < minSlack[j])
+                    {
+                        minSlack[j] = slack;
+                        previous[j] = j0;
+                    }
+                    if (minSlack[j] < delta)
+                    {
+                        delta = minSlack[j];
+                        j1 = j;
+                    }
+                }
+                for (int j = 0; j <= columns; j++)
+                {
+                    if (used[j])
+                    {
+                        rowPrice[columnRow[j]] += delta;
+                        columnPrice[j] -= delta;
+                    }
+                    else
+                        minSlack[j] -= delta;
+                }
+                j0 = j1;
+            } while (columnRow[j0] != 0);
+            do
+            {
+                int j1 = previous[j0];
+                columnRow[j0] = columnRow[j1];
+                j0 = j1;
+            } while (j0 != 0);
+        }
+
+        void remember(const vector<int> &rowKeys, const vector<int> &columnKeys)
+        {
+            fill(lastColumnKey.begin(), lastColumnKey.end(), -1);
+            for (int i = 0; i < rows; i++)
+            {
+                int key = rowKeys[i];
+                if (key >= (int)lastColumnKey.size())
+                    lastColumnKey.resize(key + 1, -1);
+                lastColumnKey[key] = assigned[i] == -1 ? -1 : columnKeys[assigned[i]];
+            }
+            fill(lastPriced.begin(), lastPriced.end(), 0);
+            for (int j = 0; j < realColumns; j++)
+            {
+                int key = columnKeys[j];
+                if (key >= (int)lastPrice.size())
+                {
+                    lastPrice.resize(key + 1, 0);
+                    lastPriced.resize(key + 1, 0);
+                }
+                lastPrice[key] = columnPrice[j + 1];
+                lastPriced[key] = 1;
+            }
+        }
+    };
+}
+
+#endif
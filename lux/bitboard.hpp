@@ -0,0 +1,257 @@
+#ifndef bitboard_h
+#define bitboard_h
+#include <cstdint>
+#include <cstring>
+#include "map.hpp"
+#include "position.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * One bit per cell of a map up to 32x32: bit x of rows[y] is the cell (x, y).
+     * Lux maps are never larger than that, so every layer is 32 words.
+     */
+    class Bitboard
+    {
+    public:
+        static constexpr int MAX_SIZE = 32;
+        uint32_t rows[MAX_SIZE] = {};
+
+        Bitboard() {}
+
+        /** Every cell of a width x height map */
+        static Bitboard full(int width, int height)
+        {
+            Bitboard board;
+            for (int y = 0; y < height; y++)
+            {
+                board.rows[y] = rowMask(width);
+            }
+            return board;
+        }
+
+        static uint32_t rowMask(int width)
+        {
+            return width >= MAX_SIZE ? ~0u : (1u << width) - 1;
+        }
+
+        bool test(int x, int y) const
+        {
+            return (rows[y] >> x) & 1u;
+        }
+
+        bool test(const Position &pos) const
+        {
+            return test(pos.x, pos.y);
+        }
+
+        void set(int x, int y)
+        {
+            rows[y] |= 1u << x;
+        }
+
+        void set(const Position &pos)
+        {
+            set(pos.x, pos.y);
+        }
+
+        void reset(int x, int y)
+        {
+            rows[y] &= ~(1u << x);
+        }
+
+        void reset(const Position &pos)
+        {
+            reset(pos.x, pos.y);
+        }
+
+        void assign(int x, int y, bool value)
+        {
+            if (value)
+                set(x, y);
+            else
+                reset(x, y);
+        }
+
+        void clear()
+        {
+            memset(rows, 0, sizeof(rows));
+        }
+
+        bool any() const
+        {
+            uint32_t bits = 0;
+            for (int y = 0; y < MAX_SIZE; y++)
+            {
+                bits |= rows[y];
+            }
+            return bits != 0;
+        }
+
+        int count() const
+        {
+            int total = 0;
+            for (int y = 0; y < MAX_SIZE; y++)
+            {
+                total += __builtin_popcount(rows[y]);
+            }
+            return total;
+        }
+
+        /** Cells sharing an edge with a set cell, clipped to the map */
+        Bitboard neighbors(int width, int height) const
+        {
+            const uint32_t mask = rowMask(width);
+            Bitboard result;
+            for (int y = 0; y < height; y++)
+            {
+                uint32_t row = (rows[y] << 1) | (rows[y] >> 1);
+                if (y > 0)
+                    row |= rows[y - 1];
+                if (y + 1 < height)
+                    row |= rows[y + 1];
+                result.rows[y] = row & mask;
+            }
+            return result;
+        }
+
+        /** The set cells grown by one step in the four directions, clipped to the map */
+        Bitboard dilate(int width, int height) const
+        {
+            Bitboard result = neighbors(width, height);
+            for (int y = 0; y < height; y++)
+            {
+                result.rows[y] |= rows[y];
+            }
+            return result;
+        }
+
+        /** Calls f(x, y) for every set cell, row by row */
+        template <class F>
+        void forEach(F f) const
+        {
+            for (int y = 0; y < MAX_SIZE; y++)
+            {
+                uint32_t bits = rows[y];
+                while (bits != 0)
+                {
+                    f(__builtin_ctz(bits), y);
+                    bits &= bits - 1;
+                }
+            }
+        }
+
+        Bitboard operator|(const Bitboard &other) const
+        {
+            Bitboard result;
+            for (int y = 0; y < MAX_SIZE; y++)
+                result.rows[y] = rows[y] | other.rows[y];
+            return result;
+        }
+
+        Bitboard operator&(const Bitboard &other) const
+        {
+            Bitboard result;
+            for (int y = 0; y < MAX_SIZE; y++)
+                result.rows[y] = rows[y] & other.rows[y];
+            return result;
+        }
+
+        Bitboard operator^(const Bitboard &other) const
+        {
+            Bitboard result;
+            for (int y = 0; y < MAX_SIZE; y++)
+                result.rows[y] = rows[y] ^ other.rows[y];
+            return result;
+        }
+
+        /** The set cells of this board that are not set in other */
+        Bitboard andNot(const Bitboard &other) const
+        {
+            Bitboard result;
+            for (int y = 0; y < MAX_SIZE; y++)
+                result.rows[y] = rows[y] & ~other.rows[y];
+            return result;
+        }
+
+        Bitboard &operator|=(const Bitboard &other)
+        {
+            for (int y = 0; y < MAX_SIZE; y++)
+                rows[y] |= other.rows[y];
+            return *this;
+        }
+
+        Bitboard &operator&=(const Bitboard &other)
+        {
+            for (int y = 0; y < MAX_SIZE; y++)
+                rows[y] &= other.rows[y];
+            return *this;
+        }
+
+        bool operator==(const Bitboard &other) const
+        {
+            return memcmp(rows, other.rows, sizeof(rows)) == 0;
+        }
+
+        bool operator!=(const Bitboard &other) const
+        {
+            return !(operator==(other));
+        }
+    };
+
+    /** Occupancy layers of the map, kept up to date by kit::Agent::update() */
+    class BitboardLayers
+    {
+    public:
+        Bitboard units[2];
+        Bitboard citytiles[2];
+        Bitboard wood;
+        Bitboard coal;
+        Bitboard uranium;
+        Bitboard roads;
+
+        const Bitboard &getResources(const ResourceType &type) const
+        {
+            switch (type)
+            {
+            case ResourceType::coal:
+                return coal;
+            case ResourceType::uranium:
+                return uranium;
+            default:
+                return wood;
+            }
+        }
+
+        /** Every cell holding a resource of any type */
+        Bitboard getAllResources() const
+        {
+            return wood | coal | uranium;
+        }
+
+        /** Re-reads the map layers of the cells changed by the last update */
+        void _applyDirtyCells(const GameMap &map)
+        {
+            for (const Position &pos : map.dirtyCells)
+            {
+                _updateCell(map, pos.x, pos.y);
+            }
+        }
+
+        void _updateCell(const GameMap &map, int x, int y)
+        {
+            int idx = map.getIndex(x, y);
+            bool hasResource = map.resourceAmount[idx] > 0;
+            wood.assign(x, y, hasResource && map.resourceType[idx] == ResourceType::wood);
+            coal.assign(x, y, hasResource && map.resourceType[idx] == ResourceType::coal);
+            uranium.assign(x, y, hasResource && map.resourceType[idx] == ResourceType::uranium);
+            roads.assign(x, y, map.road[idx] > 0);
+            citytiles[0].assign(x, y, map.citytileTeam[idx] == 0);
+            citytiles[1].assign(x, y, map.citytileTeam[idx] == 1);
+        }
+    };
+}
+
+#endif
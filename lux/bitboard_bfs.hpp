@@ -0,0 +1,182 @@
+#ifndef bitboard_bfs_h
+#define bitboard_bfs_h
+#include <vector>
+#include "bitboard.hpp"
+#include "position.hpp"
+
+// the wavefront step is built twice, for AVX2 and for the baseline, and the right one is picked when the binary loads
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define LUX_AVX2_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define LUX_AVX2_CLONES
+#endif
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * Breadth-first search that advances a whole wavefront at once on a Bitboard: one step is a shift left, a shift right
+     * and an OR with the rows above and below, for all 32 rows together.
+     * Keeps the cells reached within each number of steps, so reachability, distances, the closest cell of a set and
+     * "cells within k steps" are all read from the layers without another search.
+     */
+    class BitboardBFS
+    {
+    public:
+        /** A search stops once a step reaches nothing new, so it never takes more than MAX_DEPTH steps */
+        BitboardBFS()
+        {
+            reached.reserve(MAX_DEPTH + 1);
+        }
+
+        /**
+         * Searches from every cell of sources through the cells of passable, which must be clipped to the map.
+         * Stops after the first layer that reaches a cell of stop if one is given, or after maxDepth steps.
+         * Returns the number of steps taken.
+         */
+        int compute(const Bitboard &sources, const Bitboard &passable, const Bitboard &stop = Bitboard(), int maxDepth = MAX_DEPTH)
+        {
+            reached.resize(1);
+            reached[0] = sources;
+            bool stopping = stop.any();
+            Bitboard next;
+            while ((int)reached.size() <= maxDepth && !(stopping && (reached.back() & stop).any()))
+            {
+                grow(reached.back(), passable, next);
+                if (next == reached.back())
+                    break;
+                reached.push_back(next);
+            }
+            return reached.size() - 1;
+        }
+
+        /** Number of steps the last search took */
+        int getDepth() const
+        {
+            return reached.size() - 1;
+        }
+
+        bool isReachable(const Position &pos) const
+        {
+            return reached.back().test(pos);
+        }
+
+        /** Steps from the closest source to pos, -1 if the search did not reach it */
+        int getDistance(const Position &pos) const
+        {
+            if (!isReachable(pos))
+                return -1;
+            int low = 0, high = getDepth();
+            while (low < high)
+            {
+                int mid = (low + high) / 2;
+                if (reached[mid].test(pos))
+                    high = mid;
+                else
+                    low = mid + 1;
+            }
+            return low;
+        }
+
+        /** Cells reached within k steps, sources included */
+        const Bitboard &getWithin(int k) const
+        {
+            return reached[k < getDepth() ? k : getDepth()];
+        }
+
+        /** Cells exactly k steps away from the closest source */
+        Bitboard getLayer(int k) const
+        {
+            if (k == 0)
+                return reached[0];
+            if (k > getDepth())
+                return Bitboard();
+            return reached[k].andNot(reached[k - 1]);
+        }
+
+        /** Steps to the closest cell of targets, -1 if the search reached none */
+        int getDistanceTo(const Bitboard &targets) const
+        {
+            for (int k = 0; k <= getDepth(); k++)
+            {
+                if ((reached[k] & targets).any())
+                    return k;
+            }
+            return -1;
+        }
+
+        /** Closest cell of targets, the first in row-major order among the closest, (-1, -1) if the search reached none */
+        Position getClosest(const Bitboard &targets) const
+        {
+            int k = getDistanceTo(targets);
+            if (k == -1)
+                return Position(-1, -1);
+            Bitboard hits = reached[k] & targets;
+            for (int y = 0; y < Bitboard::MAX_SIZE; y++)
+            {
+                if (hits.rows[y] != 0)
+                    return Position(__builtin_ctz(hits.rows[y]), y);
+            }
+            return Position(-1, -1);
+        }
+
+        /**
+         * Fills path with the cells from pos back to a source, both included, empty if the search did not reach pos.
+         * Each step goes to the first neighbour one layer closer, trying west, south, east and north in that order.
+         */
+        void getPathToSource(const Position &pos, vector<Position> &path) const
+        {
+            path.clear();
+            int k = getDistance(pos);
+            if (k == -1)
+                return;
+            const DIRECTIONS order[4] = {WEST, SOUTH, EAST, NORTH};
+            Position current = pos;
+            path.push_back(current);
+            for (; k > 0; k--)
+            {
+                for (DIRECTIONS dir : order)
+                {
+                    Position next = current.translate(dir, 1);
+                    if (next.x >= 0 && next.y >= 0 && next.x < Bitboard::MAX_SIZE && next.y < Bitboard::MAX_SIZE && reached[k - 1].test(next))
+                    {
+                        current = next;
+                        break;
+                    }
+                }
+                path.push_back(current);
+            }
+        }
+
+    private:
+        static constexpr int MAX_DEPTH = Bitboard::MAX_SIZE * Bitboard::MAX_SIZE;
+
+        /** reached[k] holds the cells within k steps of a source */
+        vector<Bitboard> reached;
+
+        /** next = from grown by one step through passable, every loop runs over all 32 rows so it vectorizes */
+        LUX_AVX2_CLONES
+        static void grow(const Bitboard &from, const Bitboard &passable, Bitboard &next)
+        {
+            for (int y = 0; y < Bitboard::MAX_SIZE; y++)
+            {
+                next.rows[y] = (from.rows[y] << 1) | (from.rows[y] >> 1);
+            }
+            for (int y = 0; y + 1 < Bitboard::MAX_SIZE; y++)
+            {
+                next.rows[y] |= from.rows[y + 1];
+            }
+            for (int y = 1; y < Bitboard::MAX_SIZE; y++)
+            {
+                next.rows[y] |= from.rows[y - 1];
+            }
+            for (int y = 0; y < Bitboard::MAX_SIZE; y++)
+            {
+                next.rows[y] = (next.rows[y] & passable.rows[y]) | from.rows[y];
+            }
+        }
+    };
+}
+
+#endif
@@ -3,22 +3,41 @@
 #include <vector>
 #include <string>
 #include "position.hpp"
+#include "command.hpp"
 
 namespace lux
 {
     using namespace std;
 
+    /** Reference to a city tile that holds no pointer: the owning team, the city's index in Player::cities and the tile's index in City::citytiles */
+    class CityTileHandle
+    {
+    public:
+        signed char team = -1;
+        short city = -1;
+        short tile = -1;
+
+        CityTileHandle() {}
+        CityTileHandle(int team, int city, int tile) : team(team), city(city), tile(tile) {}
+
+        bool isValid() const
+        {
+            return team != -1;
+        }
+    };
+
     class CityTile
     {
     public:
-        string cityid;
+        /** City::uid of the city this tile belongs to */
+        int cityUid = -1;
         int team;
         Position pos;
-        int cooldown;
+        float cooldown;
 
         CityTile(){};
-        CityTile(int teamid, const string &cityid, int x, int y, int cooldown)
-        : cityid(cityid)
+        CityTile(int teamid, int cityUid, int x, int y, float cooldown)
+        : cityUid(cityUid)
         , team(teamid)
         , pos(x, y)
         , cooldown(cooldown) {}
@@ -30,22 +49,21 @@ namespace lux
         }
 
         /** returns command to ask this tile to research this turn */
-        string research() const
+        Command research() const
         {
-            return "r " + to_string(pos.x) + " " + to_string(pos.y);
-
+            return Command() << "r " << pos.x << " " << pos.y;
         }
 
         /** returns command to ask this tile to build a worker this turn */
-        string buildWorker() const
+        Command buildWorker() const
         {
-            return "bw " + to_string(pos.x) + " " + to_string(pos.y);
+            return Command() << "bw " << pos.x << " " << pos.y;
         }
 
         /** returns command to ask this tile to build a cart this turn */
-        string buildCart() const
+        Command buildCart() const
         {
-            return "bc " + to_string(pos.x) + " " + to_string(pos.y);
+            return Command() << "bc " << pos.x << " " << pos.y;
         }
     };
 
@@ -53,27 +71,39 @@ namespace lux
     {
     public:
         string cityid;
+        /** The number of cityid, dense over the cities of a match */
+        int uid = -1;
         int team;
         float fuel;
         vector<CityTile> citytiles{};
         float lightUpkeep;
+        /** Position of this city in Player::cities for the current turn */
+        int index = -1;
+        /** Night turns the current fuel lasts at the current upkeep, set by Player::_endUpdate() */
+        int nightTurnsSurvivable = 0;
 
         City(){};
-        City(int teamid, const string &cityid, float fuel, float lightUpkeep)
+        City(int teamid, const string &cityid, int uid, float fuel, float lightUpkeep)
         : cityid(cityid)
+        , uid(uid)
         , team(teamid)
         , fuel(fuel)
         , lightUpkeep(lightUpkeep) {}
 
-        void addCityTile(int x, int y, int cooldown)
+        void addCityTile(int x, int y, float cooldown)
         {
-            citytiles.emplace_back(team, cityid, x, y, cooldown);
+            citytiles.emplace_back(team, uid, x, y, cooldown);
         }
 
         float getLightUpkeep() const
         {
             return lightUpkeep;
         }
+
+        int getTileCount() const
+        {
+            return citytiles.size();
+        }
     };
 }
 #endif
@@ -0,0 +1,74 @@
+#ifndef command_h
+#define command_h
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * One command or annotation for the turn's output, built in place without touching the heap.
+     * Converts to string_view and to string, text past CAPACITY characters is cut off.
+     */
+    class Command
+    {
+    public:
+        static constexpr size_t CAPACITY = 120;
+
+        Command &operator<<(string_view text)
+        {
+            size_t count = min(text.size(), CAPACITY - length);
+            memcpy(buffer + length, text.data(), count);
+            length += count;
+            return *this;
+        }
+
+        Command &operator<<(const char *text)
+        {
+            return *this << string_view(text);
+        }
+
+        Command &operator<<(char c)
+        {
+            if (length < CAPACITY)
+                buffer[length++] = c;
+            return *this;
+        }
+
+        Command &operator<<(int value)
+        {
+            length = to_chars(buffer + length, buffer + CAPACITY, value).ptr - buffer;
+            return *this;
+        }
+
+        operator string_view() const
+        {
+            return string_view(buffer, length);
+        }
+
+        operator string() const
+        {
+            return string(buffer, length);
+        }
+
+        size_t size() const
+        {
+            return length;
+        }
+
+    private:
+        char buffer[CAPACITY];
+        size_t length = 0;
+    };
+
+    inline ostream &operator<<(ostream &out, const Command &command)
+    {
+        return out << (string_view)command;
+    }
+}
+
+#endif
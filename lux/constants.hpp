@@ -77,6 +77,110 @@ namespace lux
     CENTER = 'c'
   };
   static const DIRECTIONS ALL_DIRECTIONS[] = { NORTH, EAST, SOUTH, WEST };
+
+  /**
+   * The "PARAMETERS" of GAME_CONSTANTS as plain fields, so the kit reads them without any json lookup.
+   * The defaults must stay equal to the values above.
+   */
+  struct GameParameters
+  {
+    struct LightUpkeep
+    {
+      int CITY = 23;
+      int WORKER = 4;
+      int CART = 10;
+    };
+    struct UnitValues
+    {
+      int WORKER;
+      int CART;
+    };
+    struct ResourceValues
+    {
+      int WOOD;
+      int COAL;
+      int URANIUM;
+    };
+
+    int DAY_LENGTH = 30;
+    int NIGHT_LENGTH = 10;
+    int MAX_DAYS = 360;
+    LightUpkeep LIGHT_UPKEEP = {};
+    float WOOD_GROWTH_RATE = 1.025f;
+    int MAX_WOOD_AMOUNT = 500;
+    int CITY_BUILD_COST = 100;
+    int CITY_ADJACENCY_BONUS = 5;
+    UnitValues RESOURCE_CAPACITY = {100, 2000};
+    ResourceValues WORKER_COLLECTION_RATE = {20, 5, 2};
+    ResourceValues RESOURCE_TO_FUEL_RATE = {1, 10, 40};
+    ResourceValues RESEARCH_REQUIREMENTS = {0, 50, 200};
+    int CITY_ACTION_COOLDOWN = 10;
+    UnitValues UNIT_ACTION_COOLDOWN = {2, 3};
+    int MAX_ROAD = 6;
+    int MIN_ROAD = 0;
+    float CART_ROAD_DEVELOPMENT_RATE = 0.75f;
+    float PILLAGE_RATE = 0.5f;
+
+    /** Length of a full day and night cycle */
+    constexpr int getCycleLength() const
+    {
+      return DAY_LENGTH + NIGHT_LENGTH;
+    }
+  };
+
+  static constexpr GameParameters DEFAULT_GAME_PARAMETERS = {};
+
+#ifdef LUX_RUNTIME_PARAMETERS
+  /** Built with LUX_RUNTIME_PARAMETERS, kit::Agent::initialize() may replace these by loadGameParameters() */
+  inline GameParameters GAME_PARAMETERS = DEFAULT_GAME_PARAMETERS;
+
+  /** Overrides every field of params that is present in the "PARAMETERS" object of constants */
+  inline void loadGameParameters(const nlohmann::json &constants, GameParameters &params)
+  {
+    if (!constants.contains("PARAMETERS"))
+      return;
+    const nlohmann::json &json = constants["PARAMETERS"];
+    auto read = [&json](const char *key, auto &field)
+    {
+      if (json.contains(key))
+        field = json[key].get<std::remove_reference_t<decltype(field)>>();
+    };
+    auto readIn = [&json](const char *group, const char *key, auto &field)
+    {
+      if (json.contains(group) && json[group].contains(key))
+        field = json[group][key].get<std::remove_reference_t<decltype(field)>>();
+    };
+    read("DAY_LENGTH", params.DAY_LENGTH);
+    read("NIGHT_LENGTH", params.NIGHT_LENGTH);
+    read("MAX_DAYS", params.MAX_DAYS);
+    readIn("LIGHT_UPKEEP", "CITY", params.LIGHT_UPKEEP.CITY);
+    readIn("LIGHT_UPKEEP", "WORKER", params.LIGHT_UPKEEP.WORKER);
+    readIn("LIGHT_UPKEEP", "CART", params.LIGHT_UPKEEP.CART);
+    read("WOOD_GROWTH_RATE", params.WOOD_GROWTH_RATE);
+    read("MAX_WOOD_AMOUNT", params.MAX_WOOD_AMOUNT);
+    read("CITY_BUILD_COST", params.CITY_BUILD_COST);
+    read("CITY_ADJACENCY_BONUS", params.CITY_ADJACENCY_BONUS);
+    readIn("RESOURCE_CAPACITY", "WORKER", params.RESOURCE_CAPACITY.WORKER);
+    readIn("RESOURCE_CAPACITY", "CART", params.RESOURCE_CAPACITY.CART);
+    readIn("WORKER_COLLECTION_RATE", "WOOD", params.WORKER_COLLECTION_RATE.WOOD);
+    readIn("WORKER_COLLECTION_RATE", "COAL", params.WORKER_COLLECTION_RATE.COAL);
+    readIn("WORKER_COLLECTION_RATE", "URANIUM", params.WORKER_COLLECTION_RATE.URANIUM);
+    readIn("RESOURCE_TO_FUEL_RATE", "WOOD", params.RESOURCE_TO_FUEL_RATE.WOOD);
+    readIn("RESOURCE_TO_FUEL_RATE", "COAL", params.RESOURCE_TO_FUEL_RATE.COAL);
+    readIn("RESOURCE_TO_FUEL_RATE", "URANIUM", params.RESOURCE_TO_FUEL_RATE.URANIUM);
+    readIn("RESEARCH_REQUIREMENTS", "COAL", params.RESEARCH_REQUIREMENTS.COAL);
+    readIn("RESEARCH_REQUIREMENTS", "URANIUM", params.RESEARCH_REQUIREMENTS.URANIUM);
+    read("CITY_ACTION_COOLDOWN", params.CITY_ACTION_COOLDOWN);
+    readIn("UNIT_ACTION_COOLDOWN", "WORKER", params.UNIT_ACTION_COOLDOWN.WORKER);
+    readIn("UNIT_ACTION_COOLDOWN", "CART", params.UNIT_ACTION_COOLDOWN.CART);
+    read("MAX_ROAD", params.MAX_ROAD);
+    read("MIN_ROAD", params.MIN_ROAD);
+    read("CART_ROAD_DEVELOPMENT_RATE", params.CART_ROAD_DEVELOPMENT_RATE);
+    read("PILLAGE_RATE", params.PILLAGE_RATE);
+  }
+#else
+  static constexpr const GameParameters &GAME_PARAMETERS = DEFAULT_GAME_PARAMETERS;
+#endif
 };
 
 #endif
@@ -0,0 +1,282 @@
+#ifndef cooperative_planner_h
+#define cooperative_planner_h
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "cost_grid.hpp"
+#include "flow_field.hpp"
+#include "position.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * Windowed cooperative A*: units are planned one after the other through (cell, turn) space, each plan avoiding
+     * the cells the previous plans reserved for the next WINDOW turns, so the moves of a turn come out without collisions.
+     * Own city tiles can hold any number of units and are never reserved.
+     *
+     * Per turn: reset(), then hold() the units that keep still, then plan() the others in priority order.
+     */
+    class CooperativePlanner
+    {
+    public:
+        static constexpr int WINDOW = 8;
+        static constexpr short FREE = -1;
+
+        /** Clears the reservations, every unit reported this turn must then be held or planned */
+        void reset(const CostGrid &grid)
+        {
+            width = grid.width;
+            height = grid.height;
+            int size = width * height;
+            owner.assign((WINDOW + 1) * size, FREE);
+            if ((int)seen.size() != (WINDOW + 1) * size)
+            {
+                seen.assign((WINDOW + 1) * size, 0);
+                closed.assign((WINDOW + 1) * size, 0);
+                g.resize((WINDOW + 1) * size);
+                parent.resize((WINDOW + 1) * size);
+                open.reserve((WINDOW + 1) * size);
+                path.reserve((WINDOW + 1) * size);
+                generation = 0;
+            }
+        }
+
+        /** Reserves pos for unit from turn `from` to turn `to`, both included and clamped to the window */
+        void hold(const CostGrid &grid, int unit, const Position &pos, int from, int to)
+        {
+            int cell = pos.y * width + pos.x;
+            if (grid.cells[cell] & OWN_CITYTILE)
+                return;
+            for (int t = max(0, from); t <= min(to, WINDOW); t++)
+            {
+                owner[t * width * height + cell] = unit;
+            }
+        }
+
+        /** Drops every reservation of unit on pos, from turn 0 to the end of the window */
+        void release(const Position &pos, int unit)
+        {
+            int cell = pos.y * width + pos.x;
+            for (int t = 0; t <= WINDOW; t++)
+            {
+                short &slot = owner[t * width * height + cell];
+                if (slot == unit)
+                    slot = FREE;
+            }
+        }
+
+        /**
+         * Plans unit from start towards goal and reserves the result. A step onto a cell takes unitCooldown turns less
+         * its road level (at least one) and is priced by costs, waiting takes and costs one turn.
+         * The search stops at the goal if the unit can stay there until the end of the window, or at the first state
+         * at the end of the window, whichever is cheapest counting the Manhattan estimate of what is left.
+         * Returns the direction to move this turn, CENTER to stay; steps gets the cells the unit goes through in order.
+         */
+        DIRECTIONS plan(const CostGrid &grid, const CostProfile &costs, int unitCooldown, int unit, const Position &start, const Position &goal, vector<Position> &steps)
+        {
+            const int goalCell = goal.x >= 0 ? goal.y * width + goal.x : -1;
+            const int minCost = max(1, costs.getMinCost());
+            return search(
+                grid, costs, unitCooldown, unit, start, steps, [&](int cell)
+                { return heuristic(cell, goal, minCost); },
+                [goalCell](int cell)
+                { return cell == goalCell; });
+        }
+
+        /**
+         * The same towards any destination of flow, which must have been computed over grid with costs.
+         * Its prices are the exact cost of what is left when nobody is in the way, so the search goes straight along
+         * the field and only opens more states where reservations block it.
+         */
+        DIRECTIONS plan(const CostGrid &grid, const CostProfile &costs, int unitCooldown, int unit, const Position &start, const FlowField &flow, vector<Position> &steps)
+        {
+            return search(
+                grid, costs, unitCooldown, unit, start, steps, [&](int cell)
+                { return flow.cost[cell]; },
+                [&](int cell)
+                { return flow.cost[cell] == 0; });
+        }
+
+    private:
+        /** Space-time A* behind plan(), estimate(cell) is a consistent estimate of what is left, FlowField::UNREACHABLE for a dead end */
+        template <class Estimate, class IsGoal>
+        DIRECTIONS search(const CostGrid &grid, const CostProfile &costs, int unitCooldown, int unit, const Position &start, vector<Position> &steps, Estimate estimate, IsGoal isGoal)
+        {
+            steps.clear();
+            release(start, unit);
+            if (++generation == 0)
+            {
+                fill(seen.begin(), seen.end(), 0);
+                fill(closed.begin(), closed.end(), 0);
+                generation = 1;
+            }
+            const int size = width * height;
+            const int startCell = start.y * width + start.x;
+
+            open.clear();
+            push(startCell, 0, -1, estimate(startCell));
+
+            const int dx[5] = {0, -1, 0, 1, 0};
+            const int dy[5] = {0, 0, 1, 0, -1};
+            int found = -1;
+            while (!open.empty())
+            {
+                pop_heap(open.begin(), open.end(), greater<Entry>());
+                Entry entry = open.back();
+                open.pop_back();
+                int state = entry.state;
+                if (closed[state] == generation)
+                    continue;
+                closed[state] = generation;
+
+                int t = state / size, cell = state % size;
+                if (t == WINDOW || (isGoal(cell) && canStay(grid, unit, cell, t)))
+                {
+                    found = state;
+                    break;
+                }
+
+                int x = cell % width, y = cell / width;
+                for (int i = 0; i < 5; i++)
+                {
+                    int nx = x + dx[i], ny = y + dy[i];
+                    if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                        continue;
+                    int next = ny * width + nx;
+                    int price, duration;
+                    if (i == 0)
+                    {
+                        price = 1;
+                        duration = 1;
+                    }
+                    else
+                    {
+                        price = costs[grid.cells[next]];
+                        if (price < 0)
+                            continue;
+                        duration = max(1, unitCooldown - (grid.cells[next] & ROAD_LEVEL));
+                    }
+                    int arrival = min(t + duration, WINDOW);
+                    if (!isFree(grid, unit, next, t + 1, arrival) || (i != 0 && isSwap(unit, cell, next, t)))
+                        continue;
+                    int nextState = arrival * size + next;
+                    if (closed[nextState] == generation)
+                        continue;
+                    int left = estimate(next);
+                    if (left == FlowField::UNREACHABLE)
+                        continue;
+                    int newG = g[state] + price;
+                    if (seen[nextState] != generation || newG < g[nextState])
+                        push(nextState, newG, state, newG + left);
+                }
+            }
+
+            if (found == -1)
+            {
+                // boxed in, stay put and let the others know
+                hold(grid, unit, start, 0, WINDOW);
+                steps.push_back(start);
+                return CENTER;
+            }
+
+            // walk back to the start, then reserve every cell from the turn after the unit left the previous one
+            // until it can act again, and the last one until the end of the window
+            path.clear();
+            for (int state = found; state != -1; state = parent[state])
+            {
+                path.push_back(state);
+            }
+            reverse(path.begin(), path.end());
+            for (size_t i = 0; i < path.size(); i++)
+            {
+                Position pos(path[i] % size % width, path[i] % size / width);
+                int from = i == 0 ? 0 : path[i - 1] / size + 1;
+                int to = i + 1 < path.size() ? path[i] / size : WINDOW;
+                hold(grid, unit, pos, from, to);
+                if (steps.empty() || steps.back() != pos)
+                    steps.push_back(pos);
+            }
+            if (path.size() < 2 || path[1] % size == startCell)
+                return CENTER;
+            return start.directionTo(steps[1]);
+        }
+
+        struct Entry
+        {
+            int f;
+            int h;
+            int state;
+
+            bool operator>(const Entry &other) const
+            {
+                if (f != other.f)
+                    return f > other.f;
+                if (h != other.h)
+                    return h > other.h;
+                return state > other.state;
+            }
+        };
+
+        int width = 0;
+        int height = 0;
+        /** Unit that holds each (turn, cell), indexed by turn * width * height + cell */
+        vector<short> owner;
+        uint32_t generation = 0;
+        vector<uint32_t> seen;
+        vector<uint32_t> closed;
+        vector<int> g;
+        vector<int> parent;
+        vector<Entry> open;
+        vector<int> path;
+
+        int heuristic(int cell, const Position &goal, int minCost) const
+        {
+            if (goal.x < 0)
+                return 0;
+            return (abs(cell % width - goal.x) + abs(cell / width - goal.y)) * minCost;
+        }
+
+        void push(int state, int cost, int from, int f)
+        {
+            seen[state] = generation;
+            g[state] = cost;
+            parent[state] = from;
+            open.push_back(Entry{f, f - cost, state});
+            push_heap(open.begin(), open.end(), greater<Entry>());
+        }
+
+        bool isFree(const CostGrid &grid, int unit, int cell, int from, int to) const
+        {
+            if (grid.cells[cell] & OWN_CITYTILE)
+                return true;
+            for (int t = from; t <= to; t++)
+            {
+                short slot = owner[t * width * height + cell];
+                if (slot != FREE && slot != unit)
+                    return false;
+            }
+            return true;
+        }
+
+        /** Whether stepping from cell to next at turn t trades places with a unit going the other way */
+        bool isSwap(int unit, int cell, int next, int t) const
+        {
+            if (t + 1 > WINDOW)
+                return false;
+            const int size = width * height;
+            short other = owner[t * size + next];
+            return other != FREE && other != unit && owner[(t + 1) * size + cell] == other;
+        }
+
+        bool canStay(const CostGrid &grid, int unit, int cell, int t) const
+        {
+            return isFree(grid, unit, cell, t, WINDOW);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef cost_grid_h
+#define cost_grid_h
+#include <cstdint>
+#include <vector>
+#include "map.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /** Bits of a CostGrid cell */
+    enum COST_GRID_FLAGS
+    {
+        ROAD_LEVEL = 7,
+        OWN_UNIT = 8,
+        OWN_CITYTILE = 16,
+        ENEMY_CITYTILE = 32
+    };
+
+    /**
+     * One byte per cell describing what a path query needs to price it: the road level and whether an own unit,
+     * an own city tile or an enemy city tile is there. Brought up to date once per turn and kept current as units commit moves.
+     * A CostProfile turns a byte into a price, so a query reads one byte and one table entry per neighbour.
+     * Every byte that changes is appended to a change log, so searches kept across calls repair only those cells.
+     */
+    class CostGrid
+    {
+    public:
+        /** Changes the log keeps per cell of the map, a reader further behind reads the whole grid again */
+        static constexpr int LOG_ENTRIES_PER_CELL = 4;
+
+        int width = 0;
+        int height = 0;
+        vector<uint8_t> cells;
+
+        /**
+         * Brings the grid up to date after an update of map. When the grid was last built from the update just before,
+         * only the cells in GameMap::dirtyCells and those our units entered or left are read again, otherwise every cell is.
+         */
+        void build(const GameMap &map, const BitboardLayers &bitboards, int team)
+        {
+            bool follows = &map == builtMap && map.getGeneration() == builtGeneration + 1 && team == builtTeam && map.width == width && map.height == height;
+            builtMap = &map;
+            builtGeneration = map.getGeneration();
+            builtTeam = team;
+            if (!follows)
+            {
+                rebuild(map, bitboards, team);
+                return;
+            }
+            for (const Position &pos : map.dirtyCells)
+            {
+                if (map.getDirtyFlags(pos.x, pos.y) & (ROAD_CHANGED | CITYTILE_CHANGED))
+                    setCell(pos.x, pos.y, readCell(map, bitboards, team, pos.x, pos.y));
+            }
+            const Bitboard &units = bitboards.units[team];
+            (ownUnits ^ units).forEach([&](int x, int y)
+                                       { setOwnUnit(Position(x, y), units.test(x, y)); });
+        }
+
+        uint8_t get(int x, int y) const
+        {
+            return cells[y * width + x];
+        }
+
+        void setOwnUnit(const Position &pos, bool present)
+        {
+            uint8_t cell = cells[pos.y * width + pos.x];
+            setCell(pos.x, pos.y, present ? cell | OWN_UNIT : cell & ~OWN_UNIT);
+        }
+
+        /** Number of changes logged since the grid was created, the next change gets this number */
+        long getSerial() const
+        {
+            return serial;
+        }
+
+        /** Number of the oldest change still in the log, a reader behind it missed some */
+        long getFirstSerial() const
+        {
+            return firstSerial;
+        }
+
+        /** Index of the cell of change number s, for getFirstSerial() <= s < getSerial() */
+        int getChange(long s) const
+        {
+            return changes[s % changes.size()];
+        }
+
+    private:
+        const GameMap *builtMap = nullptr;
+        int builtGeneration = -1;
+        int builtTeam = -1;
+        /** Cells holding OWN_UNIT */
+        Bitboard ownUnits;
+        /** Ring of the indices of the cells that changed, change s at s modulo its size */
+        vector<int> changes;
+        long serial = 0;
+        long firstSerial = 0;
+
+        static uint8_t readCell(const GameMap &map, const BitboardLayers &bitboards, int team, int x, int y)
+        {
+            int road = (int)map.road[y * map.width + x];
+            uint8_t cell = road > ROAD_LEVEL ? ROAD_LEVEL : road;
+            if (bitboards.units[team].test(x, y))
+                cell |= OWN_UNIT;
+            if (bitboards.citytiles[team].test(x, y))
+                cell |= OWN_CITYTILE;
+            if (bitboards.citytiles[1 - team].test(x, y))
+                cell |= ENEMY_CITYTILE;
+            return cell;
+        }
+
+        /** Reads every cell and empties the log, so every reader starts over */
+        void rebuild(const GameMap &map, const BitboardLayers &bitboards, int team)
+        {
+            width = map.width;
+            height = map.height;
+            cells.resize(width * height);
+            changes.resize(LOG_ENTRIES_PER_CELL * width * height);
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    cells[y * width + x] = readCell(map, bitboards, team, x, y);
+                }
+            }
+            ownUnits = bitboards.units[team];
+            serial++;
+            firstSerial = serial;
+        }
+
+        void setCell(int x, int y, uint8_t cell)
+        {
+            int idx = y * width + x;
+            if (cells[idx] == cell)
+                return;
+            cells[idx] = cell;
+            ownUnits.assign(x, y, cell & OWN_UNIT);
+            changes[serial % changes.size()] = idx;
+            serial++;
+            if (serial - firstSerial > (long)changes.size())
+                firstSerial = serial - changes.size();
+        }
+    };
+
+    /** Price of stepping onto a cell for every possible CostGrid byte, negative where a unit cannot go */
+    class CostProfile
+    {
+    public:
+        int16_t costs[256];
+
+        /**
+         * A unit waits unitCooldown turns after a step, less the road level of the cell it lands on but at least one.
+         * Cells holding an own unit or an own city tile cost the given penalty on top, -1 makes them impassable.
+         * Enemy city tiles are always impassable.
+         */
+        CostProfile(int unitCooldown, int ownUnitPenalty, int ownCityTilePenalty)
+        {
+            for (int cell = 0; cell < 256; cell++)
+            {
+                int cost = unitCooldown - (cell & ROAD_LEVEL);
+                if (cost < 1)
+                    cost = 1;
+                if (cell & OWN_UNIT)
+                    cost = ownUnitPenalty < 0 ? -1 : cost + ownUnitPenalty;
+                if (cost >= 0 && (cell & OWN_CITYTILE))
+                    cost = ownCityTilePenalty < 0 ? -1 : cost + ownCityTilePenalty;
+                if (cell & ENEMY_CITYTILE)
+                    cost = -1;
+                costs[cell] = cost;
+                if (cost >= 0 && (minCost == -1 || cost < minCost))
+                    minCost = cost;
+            }
+        }
+
+        int operator[](uint8_t cell) const
+        {
+            return costs[cell];
+        }
+
+        /** The lowest price of a passable cell, what the pathfinder may scale its heuristic by */
+        int getMinCost() const
+        {
+            return minCost;
+        }
+
+    private:
+        int minCost = -1;
+    };
+}
+
+#endif
@@ -1,6 +1,137 @@
 #include "kit.hpp"
 #include <ostream>
 #include <string>
+#include <new>
+#include <cstdlib>
+
+#ifdef LUX_COUNT_ALLOCATIONS
+// the whole family is replaced so that every form allocates and frees the same way; the helpers stay out of line so
+// the compiler does not pair an inlined free() with an operator new and warn about a mismatch
+namespace
+{
+    [[gnu::noinline]] void *countedAllocate(std::size_t size, std::size_t align) noexcept
+    {
+        kit::allocationCount.fetch_add(1, std::memory_order_relaxed);
+        if (size == 0)
+            size = 1;
+        if (align <= alignof(std::max_align_t))
+            return std::malloc(size);
+        return std::aligned_alloc(align, (size + align - 1) / align * align);
+    }
+
+    void *countedAllocateOrThrow(std::size_t size, std::size_t align)
+    {
+        if (void *p = countedAllocate(size, align))
+            return p;
+        throw std::bad_alloc();
+    }
+
+    [[gnu::noinline]] void countedRelease(void *p) noexcept
+    {
+        std::free(p);
+    }
+}
+
+void *operator new(std::size_t size)
+{
+    return countedAllocateOrThrow(size, 0);
+}
+
+void *operator new[](std::size_t size)
+{
+    return countedAllocateOrThrow(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocateOrThrow(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocateOrThrow(size, (std::size_t)alignment);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAllocate(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAllocate(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return countedAllocate(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return countedAllocate(size, (std::size_t)alignment);
+}
+
+void operator delete(void *p) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    countedRelease(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    countedRelease(p);
+}
+#endif
 
 namespace kit
 {
@@ -0,0 +1,181 @@
+#ifndef distance_field_h
+#define distance_field_h
+#include <cstdint>
+#include <vector>
+#include "map.hpp"
+#include "bitboard.hpp"
+#include "resource_index.hpp"
+#include "distance_table.hpp"
+#include "position.hpp"
+#include "constants.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * Multi-source breadth-first distances over the passable cells of the map.
+     * Every reached cell stores its distance to the closest source, the first step towards it and which source that is.
+     */
+    class DistanceField
+    {
+    public:
+        static constexpr uint16_t UNREACHABLE = 0xFFFF;
+
+        int width = 0;
+        int height = 0;
+        vector<uint16_t> distance;
+        /** DIRECTIONS value of the next step towards the source, CENTER on a source and 0 where unreachable */
+        vector<char> direction;
+        /** Cell index of the closest source, -1 where unreachable */
+        vector<short> source;
+
+        /** Runs the search from every set cell of sources, only walking through passable cells */
+        void compute(int width, int height, const Bitboard &sources, const Bitboard &passable)
+        {
+            this->width = width;
+            this->height = height;
+            int size = width * height;
+            distance.assign(size, UNREACHABLE);
+            direction.assign(size, 0);
+            source.assign(size, -1);
+            queue.resize(size);
+
+            int head = 0, tail = 0;
+            sources.forEach([&](int x, int y)
+                            {
+                                if (x >= width || y >= height)
+                                    return;
+                                int idx = y * width + x;
+                                distance[idx] = 0;
+                                direction[idx] = CENTER;
+                                source[idx] = idx;
+                                queue[tail++] = idx; });
+
+            // stepping from a cell towards its neighbour means the neighbour's next step points back at the cell
+            const int dx[4] = {0, 1, 0, -1};
+            const int dy[4] = {-1, 0, 1, 0};
+            const char back[4] = {SOUTH, WEST, NORTH, EAST};
+            while (head < tail)
+            {
+                int idx = queue[head++];
+                int x = idx % width, y = idx / width;
+                for (int i = 0; i < 4; i++)
+                {
+                    int nx = x + dx[i], ny = y + dy[i];
+                    if (nx < 0 || ny < 0 || nx >= width || ny >= height || !passable.test(nx, ny))
+                        continue;
+                    int nidx = ny * width + nx;
+                    if (distance[nidx] != UNREACHABLE)
+                        continue;
+                    distance[nidx] = distance[idx] + 1;
+                    direction[nidx] = back[i];
+                    source[nidx] = source[idx];
+                    queue[tail++] = nidx;
+                }
+            }
+        }
+
+        bool isReachable(const Position &pos) const
+        {
+            return distance[pos.y * width + pos.x] != UNREACHABLE;
+        }
+
+        int getDistance(const Position &pos) const
+        {
+            return distance[pos.y * width + pos.x];
+        }
+
+        DIRECTIONS getDirection(const Position &pos) const
+        {
+            return (DIRECTIONS)direction[pos.y * width + pos.x];
+        }
+
+        /** Closest source to pos, (-1, -1) if none can be reached */
+        Position getSource(const Position &pos) const
+        {
+            int idx = source[pos.y * width + pos.x];
+            if (idx == -1)
+                return Position(-1, -1);
+            return Position(idx % width, idx / width);
+        }
+
+        /** Fills path with the cells from pos to its closest source, both included, empty if none can be reached */
+        void getPath(const Position &pos, vector<Position> &path) const
+        {
+            path.clear();
+            if (!isReachable(pos))
+                return;
+            Position current = pos;
+            path.push_back(current);
+            while (getDirection(current) != CENTER)
+            {
+                current = current.translate(getDirection(current), 1);
+                path.push_back(current);
+            }
+        }
+
+    private:
+        vector<int> queue;
+    };
+
+    /** What a field in DistanceFields leads to */
+    enum FIELD_TARGETS
+    {
+        WOOD_CELLS = 0,
+        COAL_CELLS,
+        URANIUM_CELLS,
+        FIELD_TARGET_COUNT
+    };
+
+    /**
+     * One DistanceField per FIELD_TARGETS for a team, recomputed once per turn,
+     * and the steps between every pair of cells over the same passable cells, only repaired where city tiles changed.
+     */
+    class DistanceFields
+    {
+    public:
+        /** Resource cells holding this much or less are not used as sources */
+        int minResourceAmount = 10;
+        /** Free cells next to our city tiles, where a new tile would join a city */
+        Bitboard expansions;
+
+        /** Recomputes every field and the expansions for team, enemy city tiles are the only cells units cannot walk through */
+        void update(const GameMap &map, const BitboardLayers &bitboards, int team)
+        {
+            const Bitboard allCityTiles = bitboards.citytiles[0] | bitboards.citytiles[1];
+            Bitboard passable = Bitboard::full(map.width, map.height).andNot(bitboards.citytiles[1 - team]);
+
+            Bitboard rich[ResourceIndex::TYPE_COUNT];
+            for (int idx = 0; idx < map.width * map.height; idx++)
+            {
+                if (map.resourceAmount[idx] > minResourceAmount)
+                {
+                    rich[ResourceIndex::getTypeSlot(map.resourceType[idx])].set(idx % map.width, idx / map.width);
+                }
+            }
+            expansions = bitboards.citytiles[team].neighbors(map.width, map.height).andNot(allCityTiles | bitboards.getAllResources());
+
+            fields[WOOD_CELLS].compute(map.width, map.height, rich[0], passable);
+            fields[COAL_CELLS].compute(map.width, map.height, rich[1], passable);
+            fields[URANIUM_CELLS].compute(map.width, map.height, rich[2], passable);
+            table.update(map.width, map.height, passable);
+        }
+
+        const DistanceField &get(FIELD_TARGETS target) const
+        {
+            return fields[target];
+        }
+
+        const DistanceTable &getTable() const
+        {
+            return table;
+        }
+
+    private:
+        DistanceField fields[FIELD_TARGET_COUNT];
+        DistanceTable table;
+    };
+}
+
+#endif
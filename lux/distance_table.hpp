@@ -0,0 +1,244 @@
+#ifndef distance_table_h
+#define distance_table_h
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "bitboard.hpp"
+#include "bitboard_bfs.hpp"
+#include "position.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * Steps between every pair of cells of the map through a passable board, one byte per pair, so about 1 MB for 32x32.
+     * Row s holds the breadth-first distances from s, which is always a start even when it is not passable itself.
+     * Built once, then brought up to date by update() when cells open or close: each row is repaired around the changed
+     * cell, touching only the entries whose distance actually changes.
+     */
+    class DistanceTable
+    {
+    public:
+        static constexpr uint8_t UNREACHABLE = 0xFF;
+        /** Longer ways than this are stored as unreachable, a 32x32 map would need a maze to get there */
+        static constexpr int MAX_DISTANCE = UNREACHABLE - 1;
+
+        int width = 0;
+        int height = 0;
+
+        /** Recomputes every row */
+        void build(int width, int height, const Bitboard &passable)
+        {
+            this->width = width;
+            this->height = height;
+            this->passable = passable;
+            int size = width * height;
+            table.resize(size * size);
+            marks.assign(size, 0);
+            generation = 0;
+            for (int source = 0; source < size; source++)
+            {
+                computeRow(source);
+            }
+        }
+
+        /**
+         * Brings the table to a new passable board one changed cell at a time, or rebuilds it if the size changed.
+         * Returns the number of entries the repairs went through.
+         */
+        int update(int width, int height, const Bitboard &passable)
+        {
+            if (width != this->width || height != this->height)
+            {
+                build(width, height, passable);
+                return width * height * width * height;
+            }
+            int touched = 0;
+            Bitboard changed = passable ^ this->passable;
+            changed.forEach([&](int x, int y)
+                            {
+                                int cell = y * width + x;
+                                bool opened = passable.test(x, y);
+                                this->passable.assign(x, y, opened);
+                                for (int source = 0; source < width * height; source++)
+                                {
+                                    if (source != cell)
+                                        touched += opened ? open(source, cell) : close(source, cell);
+                                } });
+            return touched;
+        }
+
+        /** Steps from one cell to the other, -1 if there is no way */
+        int get(const Position &from, const Position &to) const
+        {
+            uint8_t distance = table[(from.y * width + from.x) * width * height + to.y * width + to.x];
+            return distance == UNREACHABLE ? -1 : distance;
+        }
+
+    private:
+        Bitboard passable;
+        /** Entry source * size + target */
+        vector<uint8_t> table;
+        BitboardBFS bfs;
+        /** Cells stamped with the current generation have lost their distance in the repair in progress */
+        vector<uint32_t> marks;
+        uint32_t generation = 0;
+        vector<int> affected;
+        /** (distance, cell) pairs still to settle by a repair, stale ones are skipped when popped */
+        vector<pair<int, int>> pending;
+
+        uint8_t *row(int source)
+        {
+            return &table[source * width * height];
+        }
+
+        void computeRow(int source)
+        {
+            uint8_t *distances = row(source);
+            fill(distances, distances + width * height, UNREACHABLE);
+            Bitboard from;
+            from.set(source % width, source / width);
+            bfs.compute(from, passable, Bitboard(), MAX_DISTANCE);
+            for (int k = 0; k <= bfs.getDepth(); k++)
+            {
+                bfs.getLayer(k).forEach([&](int x, int y)
+                                        { distances[y * width + x] = k; });
+            }
+        }
+
+        /** Cells next to cell, -1 past the edge of the map */
+        void neighbours(int cell, int result[4]) const
+        {
+            int x = cell % width, y = cell / width;
+            result[0] = x > 0 ? cell - 1 : -1;
+            result[1] = y + 1 < height ? cell + width : -1;
+            result[2] = x + 1 < width ? cell + 1 : -1;
+            result[3] = y > 0 ? cell - width : -1;
+        }
+
+        /** Whether cell still has an unmarked neighbour one step closer to the source */
+        bool keepsParent(const uint8_t *distances, int cell) const
+        {
+            int around[4];
+            neighbours(cell, around);
+            for (int n : around)
+            {
+                if (n != -1 && marks[n] != generation && distances[n] + 1 == distances[cell])
+                    return true;
+            }
+            return false;
+        }
+
+        /**
+         * cell can no longer be walked through. The cells that lose their distance are those whose every neighbour one step
+         * closer is the cell or has lost its own, found layer by layer, then they are settled again from the cells around them.
+         */
+        int close(int source, int cell)
+        {
+            uint8_t *distances = row(source);
+            if (distances[cell] == UNREACHABLE)
+                return 0;
+            if (++generation == 0)
+            {
+                fill(marks.begin(), marks.end(), 0);
+                generation = 1;
+            }
+            marks[cell] = generation;
+            affected.clear();
+            affected.push_back(cell);
+            // the queue walks the layers in order, so every parent of a cell is decided before the cell is looked at
+            for (size_t i = 0; i < affected.size(); i++)
+            {
+                int around[4];
+                neighbours(affected[i], around);
+                for (int next : around)
+                {
+                    if (next == -1 || marks[next] == generation || distances[next] != distances[affected[i]] + 1)
+                        continue;
+                    if (!keepsParent(distances, next))
+                    {
+                        marks[next] = generation;
+                        affected.push_back(next);
+                    }
+                }
+            }
+
+            distances[cell] = UNREACHABLE;
+            pending.clear();
+            for (size_t i = 1; i < affected.size(); i++)
+            {
+                int lost = affected[i];
+                distances[lost] = UNREACHABLE;
+                int around[4];
+                neighbours(lost, around);
+                for (int n : around)
+                {
+                    if (n != -1 && marks[n] != generation && distances[n] < MAX_DISTANCE)
+                        pending.emplace_back(distances[n] + 1, lost);
+                }
+            }
+            make_heap(pending.begin(), pending.end(), greater<pair<int, int>>());
+            while (!pending.empty())
+            {
+                pop_heap(pending.begin(), pending.end(), greater<pair<int, int>>());
+                auto [distance, lost] = pending.back();
+                pending.pop_back();
+                if (distances[lost] <= distance)
+                    continue;
+                distances[lost] = distance;
+                if (distance >= MAX_DISTANCE)
+                    continue;
+                int around[4];
+                neighbours(lost, around);
+                for (int next : around)
+                {
+                    if (next != -1 && next != cell && marks[next] == generation && distances[next] > distance + 1)
+                    {
+                        pending.emplace_back(distance + 1, next);
+                        push_heap(pending.begin(), pending.end(), greater<pair<int, int>>());
+                    }
+                }
+            }
+            return affected.size();
+        }
+
+        /** cell can be walked through again, the shorter ways through it spread from it breadth-first */
+        int open(int source, int cell)
+        {
+            uint8_t *distances = row(source);
+            int best = UNREACHABLE;
+            int around[4];
+            neighbours(cell, around);
+            for (int n : around)
+            {
+                if (n != -1 && distances[n] < MAX_DISTANCE)
+                    best = min(best, distances[n] + 1);
+            }
+            if (best >= distances[cell])
+                return 0;
+            distances[cell] = best;
+            affected.clear();
+            affected.push_back(cell);
+            for (size_t i = 0; i < affected.size(); i++)
+            {
+                int from = affected[i];
+                if (distances[from] >= MAX_DISTANCE)
+                    continue;
+                neighbours(from, around);
+                for (int next : around)
+                {
+                    if (next == -1 || distances[next] <= distances[from] + 1 || !passable.test(next % width, next / width))
+                        continue;
+                    distances[next] = distances[from] + 1;
+                    affected.push_back(next);
+                }
+            }
+            return affected.size();
+        }
+    };
+}
+
+#endif
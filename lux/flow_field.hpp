@@ -0,0 +1,156 @@
+#ifndef flow_field_h
+#define flow_field_h
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+#include "bitboard.hpp"
+#include "cost_grid.hpp"
+#include "position.hpp"
+#include "constants.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * Cheapest way from every cell to the closest of a set of destinations over a CostGrid, from one reverse Dijkstra.
+     * Every unit heading for any of the destinations reads its next step here instead of searching for itself.
+     * Where DistanceField counts steps, this prices them like a path query does, roads and penalties included.
+     */
+    class FlowField
+    {
+    public:
+        static constexpr int UNREACHABLE = INT_MAX;
+
+        int width = 0;
+        int height = 0;
+        /** Price of the cheapest way to the closest destination, UNREACHABLE where there is none */
+        vector<int> cost;
+        /** DIRECTIONS value of the next step, CENTER on a destination and 0 where unreachable */
+        vector<char> direction;
+        /** Cell index of the destination the way leads to, -1 where unreachable */
+        vector<short> source;
+
+        /** Runs the search from every set cell of destinations, pricing each step by the cell it lands on */
+        void compute(const CostGrid &grid, const CostProfile &profile, const Bitboard &destinations)
+        {
+            width = grid.width;
+            height = grid.height;
+            int size = width * height;
+            cost.assign(size, UNREACHABLE);
+            direction.assign(size, 0);
+            source.assign(size, -1);
+
+            // Dial's algorithm: prices are small integers, so cells wait in a ring of buckets, one per cost modulo
+            // the ring size, which is more than any price so a bucket never mixes two costs at once
+            int maxPrice = 0;
+            for (int cell = 0; cell < 256; cell++)
+            {
+                maxPrice = max(maxPrice, (int)profile[cell]);
+            }
+            int ringSize = maxPrice + 1;
+            if ((int)buckets.size() < ringSize)
+                buckets.resize(ringSize);
+            for (int i = 0; i < ringSize; i++)
+            {
+                // a bucket holds one cost at a time, so every cell at most once
+                buckets[i].reserve(size);
+                buckets[i].clear();
+            }
+            int pending = 0;
+
+            destinations.forEach([&](int x, int y)
+                                 {
+                                     if (x >= width || y >= height)
+                                         return;
+                                     int idx = y * width + x;
+                                     cost[idx] = 0;
+                                     direction[idx] = CENTER;
+                                     source[idx] = idx;
+                                     buckets[0].push_back(idx);
+                                     pending++; });
+
+            // stepping from a neighbour onto the cell costs the cell's price, and the neighbour's next step points back at it
+            const int dx[4] = {0, 1, 0, -1};
+            const int dy[4] = {-1, 0, 1, 0};
+            const char back[4] = {SOUTH, WEST, NORTH, EAST};
+            for (int reached = 0; pending > 0; reached++)
+            {
+                vector<int> &bucket = buckets[reached % ringSize];
+                // cells pushed while the bucket is walked cost more, so they land in other buckets
+                for (size_t k = 0; k < bucket.size(); k++)
+                {
+                    int idx = bucket[k];
+                    pending--;
+                    if (reached != cost[idx])
+                        continue;
+                    int price = profile[grid.cells[idx]];
+                    if (price < 0)
+                        continue;
+                    int x = idx % width, y = idx / width;
+                    for (int i = 0; i < 4; i++)
+                    {
+                        int nx = x + dx[i], ny = y + dy[i];
+                        if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                            continue;
+                        int nidx = ny * width + nx;
+                        if (reached + price >= cost[nidx])
+                            continue;
+                        cost[nidx] = reached + price;
+                        direction[nidx] = back[i];
+                        source[nidx] = source[idx];
+                        buckets[cost[nidx] % ringSize].push_back(nidx);
+                        pending++;
+                    }
+                }
+                bucket.clear();
+            }
+        }
+
+        bool isReachable(const Position &pos) const
+        {
+            return cost[pos.y * width + pos.x] != UNREACHABLE;
+        }
+
+        int getCost(const Position &pos) const
+        {
+            return cost[pos.y * width + pos.x];
+        }
+
+        DIRECTIONS getDirection(const Position &pos) const
+        {
+            return (DIRECTIONS)direction[pos.y * width + pos.x];
+        }
+
+        /** Destination the way from pos leads to, (-1, -1) if none can be reached */
+        Position getSource(const Position &pos) const
+        {
+            int idx = source[pos.y * width + pos.x];
+            if (idx == -1)
+                return Position(-1, -1);
+            return Position(idx % width, idx / width);
+        }
+
+        /** Fills path with the cells from pos to its destination, both included, empty if none can be reached */
+        void getPath(const Position &pos, vector<Position> &path) const
+        {
+            path.clear();
+            if (!isReachable(pos))
+                return;
+            Position current = pos;
+            path.push_back(current);
+            while (getDirection(current) != CENTER)
+            {
+                current = current.translate(getDirection(current), 1);
+                path.push_back(current);
+            }
+        }
+
+    private:
+        /** Cells still to settle by cost modulo the ring size, stale ones are skipped when reached */
+        vector<vector<int>> buckets;
+    };
+}
+
+#endif
@@ -1,9 +1,11 @@
 #ifndef game_objects_h
 #define game_objects_h
 #include <vector>
+#include <string_view>
 #include "map.hpp"
 #include "position.hpp"
 #include "constants.hpp"
+#include "command.hpp"
 
 namespace lux
 {
@@ -26,15 +28,18 @@ namespace lux
         Position pos;
         int team;
         string id;
+        /** The number of id, dense over the units of a match */
+        int uid = -1;
         int type;
-        int cooldown;
+        float cooldown;
         Cargo cargo;
 
         Unit(){};
-        Unit(int teamid, int type, const string &unitid, int x, int y, int cooldown, int wood, int coal, int uranium)
+        Unit(int teamid, int type, const string &unitid, int uid, int x, int y, float cooldown, int wood, int coal, int uranium)
         : pos(x, y)
         , team(teamid)
         , id(unitid)
+        , uid(uid)
         , type(type)
         , cooldown(cooldown)
         , cargo(wood, coal, uranium) {}
@@ -54,11 +59,11 @@ namespace lux
             int spaceused = cargo.wood + cargo.coal + cargo.uranium;
             if (type == 0)
             {
-                return (int)GAME_CONSTANTS["PARAMETERS"]["RESOURCE_CAPACITY"]["WORKER"] - spaceused;
+                return GAME_PARAMETERS.RESOURCE_CAPACITY.WORKER - spaceused;
             }
             else
             {
-                return (int)GAME_CONSTANTS["PARAMETERS"]["RESOURCE_CAPACITY"]["CART"] - spaceused;
+                return GAME_PARAMETERS.RESOURCE_CAPACITY.CART - spaceused;
             }
         }
 
@@ -71,8 +76,7 @@ namespace lux
         /** whether or not the unit can build where it is right now */
         bool canBuild(const GameMap &gameMap) const
         {
-            auto cell = gameMap.getCellByPos(pos);
-            if (!cell->hasResource() && canAct() && (cargo.wood + cargo.coal + cargo.uranium) >= GAME_CONSTANTS["PARAMETERS"]["CITY_BUILD_COST"])
+            if (!gameMap.hasResource(pos.x, pos.y) && canAct() && (cargo.wood + cargo.coal + cargo.uranium) >= GAME_PARAMETERS.CITY_BUILD_COST)
             {
                 return true;
             }
@@ -80,15 +84,15 @@ namespace lux
         }
 
         /** return the command to move unit in the given direction */
-        string move(const DIRECTIONS &dir) const
+        Command move(const DIRECTIONS &dir) const
         {
-            return "m " + id + " " + (char)dir;
+            return Command() << "m " << id << " " << (char)dir;
         }
 
         /** return the command to transfer a resource from a source unit to a destination unit as specified by their ids or the units themselves */
-        string transfer(const string &src_unit_id, const string &dest_unit_id, const ResourceType &resourceType, int amount) const
+        Command transfer(const string &src_unit_id, const string &dest_unit_id, const ResourceType &resourceType, int amount) const
         {
-            string resourceName;
+            const char *resourceName = "";
             switch (resourceType)
             {
             case ResourceType::wood:
@@ -101,19 +105,19 @@ namespace lux
                 resourceName = "uranium";
                 break;
             }
-            return "t " + src_unit_id + " " + dest_unit_id + " " + resourceName + " " + to_string(amount);
+            return Command() << "t " << src_unit_id << " " << dest_unit_id << " " << resourceName << " " << amount;
         }
 
         /** return the command to build a city right under the worker */
-        string buildCity() const
+        Command buildCity() const
         {
-            return "bcity " + id;
+            return Command() << "bcity " << id;
         }
 
         /** return the command to pillage whatever is underneath the worker */
-        string pillage() const
+        Command pillage() const
         {
-            return "p " + id;
+            return Command() << "p " << id;
         }
     };
 
@@ -123,21 +127,164 @@ namespace lux
         int researchPoints = 0;
         int team = -1;
         vector<Unit> units{};
-        map<string, City> cities{};
+        /** The cities reported this turn, in the order they were decoded, as indexed by CityTileHandle::city */
+        vector<City> cities{};
         int cityTileCount = 0;
 
         Player(){};
         Player(int team_id) : team(team_id) {}
 
-        bool researchedCoal()
+        /** The city with this City::uid, nullptr if it was not reported this turn */
+        City *getCityByUid(int uid)
         {
-            return researchPoints >= (int)GAME_CONSTANTS["PARAMETERS"]["RESEARCH_REQUIREMENTS"]["COAL"];
+            if (uid < 0 || uid >= (int)citySlots.size() || citySlots[uid] == -1)
+                return nullptr;
+            return &cities[citySlots[uid]];
         }
 
-        bool researchedUranium()
+        /** The city a handle points into, nullptr if the handle is not a tile of this player */
+        City *getCity(const CityTileHandle &handle)
         {
-            return researchPoints >= (int)GAME_CONSTANTS["PARAMETERS"]["RESEARCH_REQUIREMENTS"]["URANIUM"];
+            if (handle.team != team || handle.city < 0 || handle.city >= (int)cities.size())
+                return nullptr;
+            return &cities[handle.city];
         }
+
+        const City *getCity(const CityTileHandle &handle) const
+        {
+            return const_cast<Player *>(this)->getCity(handle);
+        }
+
+        CityTile *getCityTile(const CityTileHandle &handle)
+        {
+            City *city = getCity(handle);
+            if (city == nullptr || handle.tile < 0 || handle.tile >= (int)city->citytiles.size())
+                return nullptr;
+            return &city->citytiles[handle.tile];
+        }
+
+        const CityTile *getCityTile(const CityTileHandle &handle) const
+        {
+            return const_cast<Player *>(this)->getCityTile(handle);
+        }
+
+        bool researchedCoal() const
+        {
+            return researchPoints >= GAME_PARAMETERS.RESEARCH_REQUIREMENTS.COAL;
+        }
+
+        bool researchedUranium() const
+        {
+            return researchPoints >= GAME_PARAMETERS.RESEARCH_REQUIREMENTS.URANIUM;
+        }
+
+        /**
+         * Room for the ids handed out over a match on a map of cells cells: every city tile builds at most one unit
+         * per CITY_ACTION_COOLDOWN turns, and cities are founded far more seldom than units are built
+         */
+        static int _idRoom(int cells)
+        {
+            return cells * (GAME_PARAMETERS.MAX_DAYS / GAME_PARAMETERS.CITY_ACTION_COOLDOWN + 1);
+        }
+
+        /**
+         * Makes room for the units and cities of a map of cells cells, so updates on it allocate nothing. Cities never
+         * touch, so there are at most half as many as cells, and every city entry holds as many tiles as cells; the
+         * room stays untouched, and so mostly unmapped, until tiles fill it.
+         */
+        void _reserve(int cells)
+        {
+            tileRoom = cells;
+            units.reserve(cells);
+            cities.reserve(cells);
+            spareCities.reserve(cells);
+            citySlots.reserve(_idRoom(cells));
+            for (City &city : cities)
+            {
+                city.citytiles.reserve(cells);
+            }
+            for (City &city : spareCities)
+            {
+                city.citytiles.reserve(cells);
+            }
+            while ((int)(cities.size() + spareCities.size()) < (cells + 1) / 2)
+            {
+                spareCities.emplace_back();
+                spareCities.back().citytiles.reserve(cells);
+            }
+        }
+
+        /** Forgets the units and cities of the last turn, the city entries are kept to be reused */
+        void _beginUpdate()
+        {
+            units.clear();
+            _beginCityUpdate();
+        }
+
+        /** Forgets the cities of the last turn but keeps the units, for a state whose cities are reported again on their own */
+        void _beginCityUpdate()
+        {
+            for (const City &city : cities)
+            {
+                citySlots[city.uid] = -1;
+            }
+            reportedCities = 0;
+            cityTileCount = 0;
+        }
+
+        /** Finds or creates the entry of a city mentioned by this update */
+        City &_getReportedCity(int uid, string_view cityid)
+        {
+            if (uid >= (int)citySlots.size())
+                citySlots.resize(uid + 1, -1);
+            int &slot = citySlots[uid];
+            if (slot == -1)
+            {
+                slot = reportedCities++;
+                if (slot == (int)cities.size() && spareCities.empty())
+                {
+                    cities.emplace_back();
+                    cities.back().citytiles.reserve(tileRoom);
+                }
+                else if (slot == (int)cities.size())
+                {
+                    cities.push_back(move(spareCities.back()));
+                    spareCities.pop_back();
+                }
+                City &city = cities[slot];
+                city.cityid.assign(cityid.data(), cityid.size());
+                city.uid = uid;
+                city.team = team;
+                city.index = slot;
+                city.fuel = 0;
+                city.lightUpkeep = 0;
+                city.citytiles.clear();
+            }
+            return cities[slot];
+        }
+
+        /** Drops the cities that were not reported and refreshes the per-city aggregates */
+        void _endUpdate()
+        {
+            while ((int)cities.size() > reportedCities)
+            {
+                spareCities.push_back(move(cities.back()));
+                cities.pop_back();
+            }
+            for (City &city : cities)
+            {
+                city.nightTurnsSurvivable = city.lightUpkeep > 0 ? (int)(city.fuel / city.lightUpkeep) : 0;
+            }
+        }
+
+    private:
+        /** Index in cities of every City::uid reported this turn, -1 for the others */
+        vector<int> citySlots{};
+        int reportedCities = 0;
+        /** Entries of the cities no longer reported, kept with their tiles' room for the next new city */
+        vector<City> spareCities{};
+        /** Tiles a new city entry makes room for, set by _reserve() */
+        int tileRoom = 0;
     };
 }
 #endif
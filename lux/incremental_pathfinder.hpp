@@ -0,0 +1,415 @@
+#ifndef incremental_pathfinder_h
+#define incremental_pathfinder_h
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "position.hpp"
+#include "cost_grid.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * D* Lite over the 4-connected cells of a CostGrid, meant to be kept by one unit for as long as it heads for the same goal.
+     * The search runs backwards from the goal and is kept between calls: when the unit has moved and a few cells changed
+     * price since the last call, only the part of the search those cells invalidated is redone.
+     * The cells to reprice are read from the change log of the grid, so calls may be any number of turns apart as long as
+     * the log still reaches back to the last one. Cell state is stamped with the search it belongs to, so a new search
+     * clears nothing.
+     */
+    class IncrementalPathFinder
+    {
+    public:
+        /**
+         * Fills path with a cheapest path from start to goal over grid priced by profile, both included, and returns its cost,
+         * or -1 with path empty if goal cannot be reached. The price of a step is the profile's price of the cell it lands on.
+         * A new goal, profile or map size starts a new search, otherwise the last one is repaired.
+         */
+        int findPath(const CostGrid &grid, const CostProfile &profile, const Position &start, const Position &goal, vector<Position> &path)
+        {
+            path.clear();
+            if (!inside(grid, start) || !inside(grid, goal))
+                return -1;
+            if (goal != this->goal || &profile != this->profile || &grid != this->grid || grid.width != width || grid.height != height || seen < grid.getFirstSerial())
+                restart(grid, profile, start, goal);
+            else
+            {
+                keyModifier += heuristic(last, start);
+                last = start;
+                applyChanges();
+            }
+            seen = grid.getSerial();
+
+            const int startIdx = start.y * width + start.x;
+            touch(startIdx);
+            computeShortestPath(startIdx);
+            if (state[startIdx].g == INF)
+                return -1;
+
+            // walk down the costs to go, they are exact around the start once the search is consistent
+            int idx = startIdx;
+            const int goalIdx = goal.y * width + goal.x;
+            path.push_back(start);
+            while (idx != goalIdx && (int)path.size() < width * height)
+            {
+                int best = -1, bestCost = INF;
+                for (int i = 0; i < 4; i++)
+                {
+                    int next = neighbour(idx, i);
+                    if (next == -1)
+                        continue;
+                    touch(next);
+                    if (state[next].g == INF || state[next].price < 0)
+                        continue;
+                    int cost = state[next].price + state[next].g;
+                    if (cost < bestCost)
+                    {
+                        best = next;
+                        bestCost = cost;
+                    }
+                }
+                if (best == -1)
+                {
+                    path.clear();
+                    return -1;
+                }
+                idx = best;
+                path.push_back(Position(idx % width, idx / width));
+            }
+            // a path visits every cell at most once, a walk that used them all without reaching the goal went wrong
+            if (idx != goalIdx)
+            {
+                path.clear();
+                return -1;
+            }
+            return state[startIdx].g;
+        }
+
+        /** Sizes the buffers for a map of cells cells up front, so no search on such a map allocates */
+        void reserve(int cells)
+        {
+            if ((int)state.size() < cells)
+                state.resize(cells);
+            heap.reserve(cells);
+        }
+
+        /** Drops the search, the next findPath() starts a new one in the same buffers */
+        void reset()
+        {
+            goal = Position(-1, -1);
+            grid = nullptr;
+        }
+
+        /** Number of cells expanded by the searches so far, to see how much the repairs save */
+        long getExpansionCount() const
+        {
+            return expansions;
+        }
+
+    private:
+        static constexpr int INF = INT_MAX / 2;
+
+        struct Key
+        {
+            int primary;
+            int secondary;
+
+            bool operator<(const Key &other) const
+            {
+                return primary != other.primary ? primary < other.primary : secondary < other.secondary;
+            }
+        };
+
+        int width = 0;
+        int height = 0;
+        Position goal = Position(-1, -1);
+        const CostGrid *grid = nullptr;
+        const CostProfile *profile = nullptr;
+        int minCost = 1;
+        /** Where the unit was at the last call, keys of older entries are behind by the distance walked since */
+        Position last;
+        int keyModifier = 0;
+        long expansions = 0;
+        /** CostGrid::getSerial() at the last call, the changes from there on are not priced in yet */
+        long seen = 0;
+        /** What the search knows of a cell, all in one place so a new finder needs a single buffer */
+        struct CellState
+        {
+            /** Search the rest belongs to, a cell of an older search is fresh: unreached and closed */
+            int stamp;
+            /** Price of the cell as the search knows it, negative where a unit cannot go */
+            int price;
+            /** Cost to go from the cell to the goal as settled by the search, and as its neighbours currently offer */
+            int g;
+            int rhs;
+            Key key;
+            /** Position of the cell in heap while it is open, -1 otherwise */
+            int heapIndex;
+        };
+
+        int generation = 0;
+        vector<CellState> state;
+        vector<int> heap;
+
+        static bool inside(const CostGrid &grid, const Position &pos)
+        {
+            return pos.x >= 0 && pos.y >= 0 && pos.x < grid.width && pos.y < grid.height;
+        }
+
+        int heuristic(const Position &a, const Position &b) const
+        {
+            return (abs(a.x - b.x) + abs(a.y - b.y)) * minCost;
+        }
+
+        int heuristic(int idx, const Position &pos) const
+        {
+            return (abs(idx % width - pos.x) + abs(idx / width - pos.y)) * minCost;
+        }
+
+        /** Cell next to idx in direction i, -1 past the edge of the map */
+        int neighbour(int idx, int i) const
+        {
+            int x = idx % width, y = idx / width;
+            switch (i)
+            {
+            case 0:
+                return x > 0 ? idx - 1 : -1;
+            case 1:
+                return y + 1 < height ? idx + width : -1;
+            case 2:
+                return x + 1 < width ? idx + 1 : -1;
+            default:
+                return y > 0 ? idx - width : -1;
+            }
+        }
+
+        void restart(const CostGrid &grid, const CostProfile &profile, const Position &start, const Position &goal)
+        {
+            width = grid.width;
+            height = grid.height;
+            this->grid = &grid;
+            this->goal = goal;
+            this->profile = &profile;
+            minCost = max(1, profile.getMinCost());
+            last = start;
+            keyModifier = 0;
+            reserve(width * height);
+            generation++;
+            heap.clear();
+
+            int goalIdx = goal.y * width + goal.x;
+            touch(goalIdx);
+            state[goalIdx].rhs = 0;
+            push(goalIdx, Key{heuristic(goalIdx, start), 0});
+        }
+
+        /** Gives idx its initial state if it was not part of the current search yet, priced as the grid is now */
+        void touch(int idx)
+        {
+            if (state[idx].stamp == generation)
+                return;
+            state[idx].stamp = generation;
+            state[idx].price = (*profile)[grid->cells[idx]];
+            state[idx].g = INF;
+            state[idx].rhs = INF;
+            state[idx].heapIndex = -1;
+        }
+
+        /** Reprices the cells logged by the grid since the last call and reopens the cells whose way through them changed */
+        void applyChanges()
+        {
+            const int goalIdx = goal.y * width + goal.x;
+            for (long change = seen; change < grid->getSerial(); change++)
+            {
+                int idx = grid->getChange(change);
+                // a cell the search has not read yet gets the new price when it does
+                if (state[idx].stamp != generation)
+                    continue;
+                int oldPrice = state[idx].price;
+                int newPrice = (*profile)[grid->cells[idx]];
+                if (newPrice == oldPrice)
+                    continue;
+                state[idx].price = newPrice;
+                if (state[idx].g == INF)
+                    continue;
+                // every neighbour steps onto idx, so the price of idx is the cost of each of their edges towards it
+                for (int i = 0; i < 4; i++)
+                {
+                    int from = neighbour(idx, i);
+                    if (from == -1 || from == goalIdx)
+                        continue;
+                    touch(from);
+                    if (newPrice >= 0 && (oldPrice < 0 || newPrice < oldPrice))
+                        state[from].rhs = min(state[from].rhs, newPrice + state[idx].g);
+                    else if (oldPrice >= 0 && state[from].rhs == oldPrice + state[idx].g)
+                        state[from].rhs = bestThroughNeighbours(from);
+                    updateCell(from);
+                }
+            }
+        }
+
+        int bestThroughNeighbours(int idx)
+        {
+            int best = INF;
+            for (int i = 0; i < 4; i++)
+            {
+                int next = neighbour(idx, i);
+                if (next == -1)
+                    continue;
+                touch(next);
+                if (state[next].price >= 0 && state[next].g != INF)
+                    best = min(best, state[next].price + state[next].g);
+            }
+            return best;
+        }
+
+        Key calculateKey(int idx) const
+        {
+            int best = min(state[idx].g, state[idx].rhs);
+            if (best == INF)
+                return Key{INF, INF};
+            return Key{best + heuristic(idx, last) + keyModifier, best};
+        }
+
+        void updateCell(int idx)
+        {
+            bool open = state[idx].heapIndex != -1;
+            if (state[idx].g != state[idx].rhs)
+            {
+                if (open)
+                    changeKey(idx, calculateKey(idx));
+                else
+                    push(idx, calculateKey(idx));
+            }
+            else if (open)
+                remove(idx);
+        }
+
+        void computeShortestPath(int startIdx)
+        {
+            const int goalIdx = goal.y * width + goal.x;
+            while (!heap.empty() && (state[heap[0]].key < calculateKey(startIdx) || state[startIdx].rhs != state[startIdx].g))
+            {
+                int idx = heap[0];
+                Key oldKey = state[idx].key;
+                Key newKey = calculateKey(idx);
+                expansions++;
+                if (oldKey < newKey)
+                {
+                    changeKey(idx, newKey);
+                }
+                else if (state[idx].g > state[idx].rhs)
+                {
+                    state[idx].g = state[idx].rhs;
+                    remove(idx);
+                    if (state[idx].price < 0)
+                        continue;
+                    for (int i = 0; i < 4; i++)
+                    {
+                        int from = neighbour(idx, i);
+                        if (from == -1 || from == goalIdx)
+                            continue;
+                        touch(from);
+                        state[from].rhs = min(state[from].rhs, state[idx].price + state[idx].g);
+                        updateCell(from);
+                    }
+                }
+                else
+                {
+                    int oldG = state[idx].g;
+                    state[idx].g = INF;
+                    for (int i = 0; i < 5; i++)
+                    {
+                        int from = i == 4 ? idx : neighbour(idx, i);
+                        if (from == -1 || from == goalIdx)
+                            continue;
+                        touch(from);
+                        if (from == idx || (state[idx].price >= 0 && state[from].rhs == state[idx].price + oldG))
+                            state[from].rhs = bestThroughNeighbours(from);
+                        updateCell(from);
+                    }
+                }
+            }
+        }
+
+        void push(int idx, const Key &key)
+        {
+            state[idx].key = key;
+            state[idx].heapIndex = heap.size();
+            heap.push_back(idx);
+            siftUp(heap.size() - 1);
+        }
+
+        void changeKey(int idx, const Key &key)
+        {
+            state[idx].key = key;
+            siftUp(state[idx].heapIndex);
+            siftDown(state[idx].heapIndex);
+        }
+
+        void remove(int idx)
+        {
+            int pos = state[idx].heapIndex;
+            int lastIdx = heap.back();
+            heap.pop_back();
+            state[idx].heapIndex = -1;
+            if (lastIdx == idx)
+                return;
+            heap[pos] = lastIdx;
+            state[lastIdx].heapIndex = pos;
+            siftUp(pos);
+            siftDown(state[lastIdx].heapIndex);
+        }
+
+        bool before(int a, int b) const
+        {
+            if (state[a].key < state[b].key)
+                return true;
+            if (state[b].key < state[a].key)
+                return false;
+            return a < b;
+        }
+
+        void siftUp(int pos)
+        {
+            int idx = heap[pos];
+            while (pos > 0)
+            {
+                int parentPos = (pos - 1) / 2;
+                if (!before(idx, heap[parentPos]))
+                    break;
+                heap[pos] = heap[parentPos];
+                state[heap[pos]].heapIndex = pos;
+                pos = parentPos;
+            }
+            heap[pos] = idx;
+            state[idx].heapIndex = pos;
+        }
+
+        void siftDown(int pos)
+        {
+            int idx = heap[pos];
+            int size = heap.size();
+            while (true)
+            {
+                int child = 2 * pos + 1;
+                if (child >= size)
+                    break;
+                if (child + 1 < size && before(heap[child + 1], heap[child]))
+                    child++;
+                if (!before(heap[child], idx))
+                    break;
+                heap[pos] = heap[child];
+                state[heap[pos]].heapIndex = pos;
+                pos = child;
+            }
+            heap[pos] = idx;
+            state[idx].heapIndex = pos;
+        }
+    };
+}
+
+#endif
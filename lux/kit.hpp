@@ -4,10 +4,16 @@
 #define kit_h
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <vector>
+#include <charconv>
 #include "map.hpp"
+#include "bitboard.hpp"
+#include "resource_index.hpp"
+#include "resource_clusters.hpp"
 #include "lux_io.hpp"
+#include "arena.hpp"
 #include "game_objects.hpp"
 #include "annotate.hpp"
 #include "city.hpp"
@@ -16,41 +22,72 @@ namespace kit
 {
     using namespace std;
 
-    static string getline()
+    static int parseInt(string_view field)
     {
-        // exit if stdin is bad now
-        if (!cin.good())
-            exit(0);
-
-        char str[2048], ch;
-        int i = 0;
-        ch = getchar();
-        while (ch != '\n')
-        {
-            str[i] = ch;
-            i++;
-            ch = getchar();
-        }
+        int value = 0;
+        from_chars(field.data(), field.data() + field.size(), value);
+        return value;
+    }
+
+    static float parseFloat(string_view field)
+    {
+        float value = 0;
+        from_chars(field.data(), field.data() + field.size(), value);
+        return value;
+    }
 
-        str[i] = '\0';
-        // return the line
-        return string(str);
+    /**
+     * Interns a unit or city id such as "u_12" or "c_3" as the number after the underscore.
+     * The game numbers units and cities from one counter each, so these are dense small integers.
+     */
+    static int parseId(string_view id)
+    {
+        size_t separator = id.find('_');
+        return parseInt(separator == string_view::npos ? id : id.substr(separator + 1));
     }
 
-    static vector<string> tokenize(string s, string del = " ")
+    /** Splits a line on a delimiter without allocating, fields are views into the line */
+    class Tokenizer
     {
-        vector<string> strings = vector<string>();
-        int start = 0;
-        int end = s.find(del);
-        while (end != -1)
+    public:
+        Tokenizer(string_view line, char del = ' ') : rest(line), del(del) {}
+
+        bool done() const
         {
-            strings.push_back(s.substr(start, end - start));
-            start = end + del.size();
-            end = s.find(del, start);
+            return exhausted;
         }
-        strings.push_back(s.substr(start, end - start));
-        return strings;
-    }
+
+        string_view next()
+        {
+            size_t end = rest.find(del);
+            string_view field = rest.substr(0, end);
+            if (end == string_view::npos)
+            {
+                rest = string_view();
+                exhausted = true;
+            }
+            else
+            {
+                rest.remove_prefix(end + 1);
+            }
+            return field;
+        }
+
+        int nextInt()
+        {
+            return parseInt(next());
+        }
+
+        float nextFloat()
+        {
+            return parseFloat(next());
+        }
+
+    private:
+        string_view rest;
+        char del;
+        bool exhausted = false;
+    };
 
     class Agent
     {
@@ -61,6 +98,13 @@ namespace kit
         int mapHeight = -1;
         lux::GameMap map;
         lux::Player players[2] = {lux::Player(0), lux::Player(1)};
+        lux::BitboardLayers bitboards;
+        lux::ResourceIndex resourceIndex;
+        lux::ResourceClusters clusters;
+        InputReader input;
+        Recorder recorder;
+        /** Memory for this turn only, everything allocated from it is released by the next update() */
+        TurnArena arena;
         Agent()
         {
         }
@@ -71,15 +115,32 @@ namespace kit
         void initialize()
         {
             // get agent ID
-            id = stoi(kit::getline());
-            string map_info = kit::getline();
+            string_view id_info = input.getline();
+            id = parseInt(id_info);
+            string_view map_info = input.getline();
+            Tokenizer map_parts(map_info);
 
-            vector<string> map_parts = kit::tokenize(map_info, " ");
+            // LUX_RECORD=<prefix> records the input of this agent to <prefix>_<id>.rec
+            const char *recordPrefix = getenv("LUX_RECORD");
+            if (recordPrefix != nullptr && recorder.open(string(recordPrefix) + "_" + to_string(id) + ".rec"))
+            {
+                recorder.write(string(id_info) + "\n" + string(map_info) + "\n");
+            }
 
-            mapWidth = stoi(map_parts[0]);
-            mapHeight = stoi(map_parts[1]);
+#ifdef LUX_RUNTIME_PARAMETERS
+            // LUX_PARAMETERS=<file> reads rule variants from a file shaped like game_constants.json
+            const char *parametersPath = getenv("LUX_PARAMETERS");
+            if (parametersPath != nullptr)
+            {
+                ifstream parametersFile(parametersPath);
+                if (parametersFile)
+                    lux::loadGameParameters(nlohmann::json::parse(parametersFile), lux::GAME_PARAMETERS);
+            }
+#endif
 
-            map = lux::GameMap(mapWidth, mapHeight);
+            int width = map_parts.nextInt();
+            int height = map_parts.nextInt();
+            _setMapSize(width, height);
         }
         // end a turn
         static void end_turn()
@@ -90,105 +151,141 @@ namespace kit
 
         /**
          * Updates agent's own known state of `Match`.
+         * The map and the entity containers are kept across turns and only what changed is applied,
+         * see `GameMap::dirtyCells` for the cells touched by this update.
          * User should edit this according to their `Design`.
          */
         void update()
         {
             turn++;
-            resetPlayerStates();
-            map = lux::GameMap(mapWidth, mapHeight);
+            _beginUpdate();
 
+            input.readBlock();
+            recorder.write(input.block());
             while (true)
             {
-                string updateInfo = kit::getline();
+                string_view updateInfo = input.getline();
                 if (updateInfo == INPUT_CONSTANTS::DONE)
                 {
                     break;
                 }
-                vector<string> updates = kit::tokenize(updateInfo, " ");
-                string input_identifier = updates[0];
-                if (input_identifier == INPUT_CONSTANTS::RESEARCH_POINTS)
+                Tokenizer updates(updateInfo);
+                string_view input_identifier = updates.next();
+                if (input_identifier.empty())
+                    continue;
+                // dispatch on the first bytes: "rp", "r", "u", "c", "ct" or "ccd"
+                switch (input_identifier[0])
                 {
-                    int team = stoi(updates[1]);
-                    players[team].researchPoints = stoi(updates[2]);
-                }
-                else if (input_identifier == INPUT_CONSTANTS::RESOURCES)
-                {
-                    string type = updates[1];
-                    int x = stoi(updates[2]);
-                    int y = stoi(updates[3]);
-                    int amt = stoi(updates[4]);
-                    lux::ResourceType rtype = lux::ResourceType(type.at(0));
-                    map._setResource(rtype, x, y, amt);
-                }
-                else if (input_identifier == INPUT_CONSTANTS::UNITS)
-                {
-                    int i = 1;
-                    int unittype = stoi(updates[i++]);
-                    int team = stoi(updates[i++]);
-                    string unitid = updates[i++];
-                    int x = stoi(updates[i++]);
-                    int y = stoi(updates[i++]);
-                    float cooldown = stof(updates[i++]);
-                    int wood = stoi(updates[i++]);
-                    int coal = stoi(updates[i++]);
-                    int uranium = stoi(updates[i++]);
-                    lux::Unit unit = lux::Unit(team, unittype, unitid, x, y, cooldown, wood, coal, uranium);
-                    players[team].units.push_back(unit);
-                }
-                else if (input_identifier == INPUT_CONSTANTS::CITY)
-                {
-                    int i = 1;
-                    int team = stoi(updates[i++]);
-                    string cityid = updates[i++];
-                    float fuel = stof(updates[i++]);
-                    float lightUpkeep = stof(updates[i++]);
-                    players[team].cities[cityid] = lux::City(team, cityid, fuel, lightUpkeep);
-                }
-                else if (input_identifier == INPUT_CONSTANTS::CITY_TILES)
+                case 'r':
+                    if (input_identifier.size() == 2)
+                    {
+                        int team = updates.nextInt();
+                        players[team].researchPoints = updates.nextInt();
+                    }
+                    else
+                    {
+                        lux::ResourceType rtype = lux::ResourceType(updates.next()[0]);
+                        int x = updates.nextInt();
+                        int y = updates.nextInt();
+                        int amt = updates.nextInt();
+                        map._setResource(rtype, x, y, amt);
+                    }
+                    break;
+                case 'u':
                 {
-                    int i = 1;
-                    int team = stoi(updates[i++]);
-                    string cityid = updates[i++];
-                    int x = stoi(updates[i++]);
-                    int y = stoi(updates[i++]);
-                    float cooldown = stof(updates[i++]);
-                    lux::City * city = &players[team].cities[cityid];
-                    city->addCityTile(x, y, cooldown);
-                    players[team].cityTileCount += 1;
+                    int unittype = updates.nextInt();
+                    int team = updates.nextInt();
+                    string_view unitid = updates.next();
+                    int x = updates.nextInt();
+                    int y = updates.nextInt();
+                    float cooldown = updates.nextFloat();
+                    int wood = updates.nextInt();
+                    int coal = updates.nextInt();
+                    int uranium = updates.nextInt();
+                    players[team].units.emplace_back(team, unittype, string(unitid), parseId(unitid), x, y, cooldown, wood, coal, uranium);
+                    break;
                 }
-                else if (input_identifier == INPUT_CONSTANTS::ROADS)
-                {
-                    int i = 1;
-                    int x = stoi(updates[i++]);
-                    int y = stoi(updates[i++]);
-                    float road = stof(updates[i++]);
-                    lux::Cell * cell = map.getCell(x, y);
-                    cell->road = road;
+                case 'c':
+                    if (input_identifier.size() == 1)
+                    {
+                        int team = updates.nextInt();
+                        string_view cityid = updates.next();
+                        float fuel = updates.nextFloat();
+                        float lightUpkeep = updates.nextFloat();
+                        lux::City &city = players[team]._getReportedCity(parseId(cityid), cityid);
+                        city.fuel = fuel;
+                        city.lightUpkeep = lightUpkeep;
+                    }
+                    else if (input_identifier[1] == 't')
+                    {
+                        int team = updates.nextInt();
+                        string_view cityid = updates.next();
+                        int x = updates.nextInt();
+                        int y = updates.nextInt();
+                        float cooldown = updates.nextFloat();
+                        lux::City &city = players[team]._getReportedCity(parseId(cityid), cityid);
+                        map._setCityTile(x, y, lux::CityTileHandle(team, city.index, city.citytiles.size()));
+                        city.addCityTile(x, y, cooldown);
+                        players[team].cityTileCount += 1;
+                    }
+                    else
+                    {
+                        int x = updates.nextInt();
+                        int y = updates.nextInt();
+                        float road = updates.nextFloat();
+                        map._setRoad(x, y, road);
+                    }
+                    break;
                 }
             }
+            _endUpdate();
+        }
+
+        /** Starts an empty width x height map, dropping everything derived from the previous one */
+        void _setMapSize(int width, int height)
+        {
+            mapWidth = width;
+            mapHeight = height;
+            map = lux::GameMap(mapWidth, mapHeight);
+            bitboards = lux::BitboardLayers();
+            resourceIndex.reset(mapWidth, mapHeight);
+            clusters.reset(mapWidth, mapHeight);
             for (lux::Player &player : players)
             {
-                for (auto &element : player.cities)
-                {
-                    lux::City &city = element.second;
-                    for (lux::CityTile &citytile : city.citytiles)
-                    {
-                        const lux::Position &pos = citytile.pos;
-                        map.getCell(pos.x, pos.y)->citytile = &citytile;
-                    }
-                }
+                player._reserve(mapWidth * mapHeight);
             }
         }
 
-    private:
-        void resetPlayerStates()
+        /** Forgets the units and cities of the last turn and opens the map for an update, before anything of the new turn is set */
+        void _beginUpdate()
+        {
+            arena.reset();
+            for (lux::Player &player : players)
+            {
+                player._beginUpdate();
+            }
+            map._beginUpdate();
+        }
+
+        /** Closes an update opened by _beginUpdate() and brings the bitboards, resource index and clusters up to date from the dirty cells */
+        void _endUpdate()
         {
-            for (int team = 0; team < 2; team++)
+            for (lux::Player &player : players)
             {
-                players[team].units.clear();
-                players[team].cities.clear();
-                players[team].cityTileCount = 0;
+                player._endUpdate();
+            }
+            map._endUpdate();
+            bitboards._applyDirtyCells(map);
+            resourceIndex._applyDirtyCells(map);
+            clusters._applyDirtyCells(map);
+            for (lux::Player &player : players)
+            {
+                lux::Bitboard &units = bitboards.units[player.team];
+                units.clear();
+                for (const lux::Unit &unit : player.units)
+                {
+                    units.set(unit.pos);
+                }
             }
         }
     };
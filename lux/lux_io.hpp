@@ -3,6 +3,14 @@
 
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
 
 namespace kit
 {
@@ -19,6 +27,192 @@ namespace kit
         static string CITY_TILES;
         static string ROADS;
     };
+
+    /**
+     * Buffered line reader over a file descriptor.
+     * A whole update block (everything up to D_DONE) is slurped with large read() calls
+     * into a buffer that is reused across turns, and lines are handed out as views into it.
+     */
+    class InputReader
+    {
+    public:
+        static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+        InputReader(int fd = 0) : fd(fd), buffer(CHUNK_SIZE) {}
+        /** Reads from an in-memory copy of a stream instead of a file descriptor */
+        InputReader(string_view data) : fd(-1), buffer(data.begin(), data.end()), filled(data.size())
+        {
+            buffer.resize(data.size() + CHUNK_SIZE);
+        }
+
+        /**
+         * Appends data to an in-memory reader after dropping the bytes already read, so a reader fed block after block
+         * keeps one buffer. Views returned by getline() before are no longer valid.
+         */
+        void feed(string_view data)
+        {
+            compact();
+            if (buffer.size() < filled + data.size())
+                buffer.resize(filled + data.size() + CHUNK_SIZE);
+            memcpy(buffer.data() + filled, data.data(), data.size());
+            filled += data.size();
+        }
+
+        /**
+         * Makes sure the next update block is fully buffered.
+         * Views returned by getline() for this block stay valid until the next call to readBlock().
+         */
+        void readBlock()
+        {
+            compact();
+            while (true)
+            {
+                const char *newline;
+                while ((newline = (const char *)memchr(buffer.data() + scanned, '\n', filled - scanned)) != nullptr)
+                {
+                    size_t lineStart = scanned;
+                    scanned = newline - buffer.data() + 1;
+                    if (string_view(buffer.data() + lineStart, scanned - 1 - lineStart) == INPUT_CONSTANTS::DONE)
+                    {
+                        blockEnd = scanned;
+                        return;
+                    }
+                }
+                if (!fill())
+                    exit(0);
+            }
+        }
+
+        /** Returns the next line without its trailing newline, refilling the buffer if needed */
+        string_view getline()
+        {
+            const char *newline;
+            while ((newline = (const char *)memchr(buffer.data() + cursor, '\n', filled - cursor)) == nullptr)
+            {
+                // exit if stdin is bad now
+                if (!fill())
+                    exit(0);
+            }
+            string_view line(buffer.data() + cursor, newline - buffer.data() - cursor);
+            cursor = newline - buffer.data() + 1;
+            return line;
+        }
+
+        /** Raw bytes of the block buffered by the last readBlock(), D_DONE line included */
+        string_view block() const
+        {
+            return string_view(buffer.data(), blockEnd);
+        }
+
+    private:
+        int fd;
+        vector<char> buffer;
+        size_t cursor = 0;
+        size_t filled = 0;
+        size_t scanned = 0;
+        size_t blockEnd = 0;
+
+        /** Moves the unread bytes to the front of the buffer */
+        void compact()
+        {
+            if (cursor > 0)
+            {
+                memmove(buffer.data(), buffer.data() + cursor, filled - cursor);
+                filled -= cursor;
+                scanned = scanned > cursor ? scanned - cursor : 0;
+                cursor = 0;
+            }
+            blockEnd = 0;
+        }
+
+        /** Reads the next chunk from fd, growing the buffer when it is full. Returns false on EOF */
+        bool fill()
+        {
+            if (fd < 0)
+                return false;
+            if (buffer.size() - filled < CHUNK_SIZE / 2)
+                buffer.resize(buffer.size() * 2);
+            ssize_t n;
+            do
+            {
+                n = read(fd, buffer.data() + filled, buffer.size() - filled);
+            } while (n < 0 && errno == EINTR);
+            if (n <= 0)
+                return false;
+            filled += n;
+            return true;
+        }
+    };
+
+    /**
+     * Writes the raw input blocks an agent reads to a file, so a match can be played back offline.
+     * The file is the magic "LUXR" followed by records, each a 32 bit little endian length and the block bytes.
+     */
+    class Recorder
+    {
+    public:
+        Recorder() {}
+        Recorder(const Recorder &) = delete;
+        Recorder &operator=(const Recorder &) = delete;
+        ~Recorder()
+        {
+            if (file != nullptr)
+                fclose(file);
+        }
+
+        bool open(const string &path)
+        {
+            file = fopen(path.c_str(), "wb");
+            if (file == nullptr)
+                return false;
+            fwrite("LUXR", 1, 4, file);
+            return true;
+        }
+
+        bool isOpen() const
+        {
+            return file != nullptr;
+        }
+
+        void write(string_view block)
+        {
+            if (file == nullptr)
+                return;
+            uint32_t size = block.size();
+            unsigned char header[4] = {(unsigned char)size, (unsigned char)(size >> 8), (unsigned char)(size >> 16), (unsigned char)(size >> 24)};
+            fwrite(header, 1, 4, file);
+            fwrite(block.data(), 1, block.size(), file);
+            // flush every turn so a killed agent still leaves a usable recording
+            fflush(file);
+        }
+
+        /** Loads a recording back as the raw stream it was taken from, returns false if the file is not a recording */
+        static bool load(const string &path, string &stream, int &blocks)
+        {
+            FILE *in = fopen(path.c_str(), "rb");
+            if (in == nullptr)
+                return false;
+            char magic[4];
+            bool valid = fread(magic, 1, 4, in) == 4 && memcmp(magic, "LUXR", 4) == 0;
+            stream.clear();
+            blocks = 0;
+            unsigned char header[4];
+            while (valid && fread(header, 1, 4, in) == 4)
+            {
+                uint32_t size = header[0] | header[1] << 8 | header[2] << 16 | (uint32_t)header[3] << 24;
+                size_t start = stream.size();
+                stream.resize(start + size);
+                if (fread(&stream[start], 1, size, in) != size)
+                    valid = false;
+                blocks++;
+            }
+            fclose(in);
+            return valid;
+        }
+
+    private:
+        FILE *file = nullptr;
+    };
 }
 
 #endif
@@ -15,6 +15,15 @@ namespace lux
         uranium = 'u'
     };
 
+    /** Why a cell changed during the last update, combined as a bit mask */
+    enum DIRTY_FLAGS
+    {
+        RESOURCE_CHANGED = 1,
+        RESOURCE_DEPLETED = 2,
+        CITYTILE_CHANGED = 4,
+        ROAD_CHANGED = 8
+    };
+
     class Resource
     {
     public:
@@ -25,16 +34,22 @@ namespace lux
         Resource(ResourceType type, int amount) : type(type), amount(amount) {}
     };
 
+    /** One map cell, assembled from the GameMap layers by getCell() */
     class Cell
     {
     public:
         Position pos;
         Resource resource;
-        CityTile * citytile = nullptr;
+        CityTileHandle citytile;
         float road = 0.0;
 
         Cell(){}
         Cell(int x, int y) : pos(x, y) {}
+        Cell(int x, int y, const Resource &resource, const CityTileHandle &citytile, float road)
+        : pos(x, y)
+        , resource(resource)
+        , citytile(citytile)
+        , road(road) {}
 
         bool hasResource() const
         {
@@ -42,52 +57,175 @@ namespace lux
         }
     };
 
+    /**
+     * The map as one contiguous grid stored as structure-of-arrays layers, indexed by y * width + x.
+     * Full-map scans should walk the layers directly, getCell() gathers a single cell from them.
+     */
     class GameMap
     {
     public:
         int width = -1;
         int height = -1;
-        vector<vector<Cell>> map;
+        vector<ResourceType> resourceType;
+        /** -1 where there is no resource */
+        vector<int> resourceAmount;
+        vector<float> road;
+        /** Team owning the city tile on the cell, -1 if there is none */
+        vector<signed char> citytileTeam;
+        /** City and tile index of the city tile on the cell, see CityTileHandle */
+        vector<short> citytileCity;
+        vector<short> citytileIndex;
+        /** Cells that changed during the last update, see getDirtyFlags() for the reason */
+        vector<Position> dirtyCells;
 
         GameMap(){};
         GameMap(int width, int height) : width(width), height(height)
         {
-            map = vector<vector<Cell>>(height, vector<Cell>(width));
-            for (int y = 0; y < height; y++)
+            int size = width * height;
+            resourceType = vector<ResourceType>(size, ResourceType::wood);
+            resourceAmount = vector<int>(size, -1);
+            road = vector<float>(size, 0);
+            citytileTeam = vector<signed char>(size, -1);
+            citytileCity = vector<short>(size, -1);
+            citytileIndex = vector<short>(size, -1);
+            dirtyFlags = vector<int>(size, 0);
+            resourceSeen = vector<int>(size, -1);
+            roadSeen = vector<int>(size, -1);
+            citytileSeen = vector<int>(size, -1);
+        }
+
+        int getIndex(int x, int y) const
+        {
+            return y * width + x;
+        }
+
+        bool inBounds(int x, int y) const
+        {
+            return x >= 0 && y >= 0 && x < width && y < height;
+        }
+
+        Cell getCellByPos(const Position &pos) const
+        {
+            return getCell(pos.x, pos.y);
+        }
+
+        Cell getCell(int x, int y) const
+        {
+            int idx = getIndex(x, y);
+            return Cell(x, y, Resource(resourceType[idx], resourceAmount[idx]), getCityTileHandle(x, y), road[idx]);
+        }
+
+        CityTileHandle getCityTileHandle(int x, int y) const
+        {
+            int idx = getIndex(x, y);
+            return CityTileHandle(citytileTeam[idx], citytileCity[idx], citytileIndex[idx]);
+        }
+
+        bool hasResource(int x, int y) const
+        {
+            return resourceAmount[getIndex(x, y)] > 0;
+        }
+
+        /** DIRTY_FLAGS of the cell for the last update, 0 if it did not change */
+        int getDirtyFlags(int x, int y) const
+        {
+            return dirtyFlags[getIndex(x, y)];
+        }
+
+        /** Number of updates begun on this map, dirtyCells holds the changes of the latest one */
+        int getGeneration() const
+        {
+            return generation;
+        }
+
+        /** Starts a new update: the previous dirty set is dropped and cells not set again before _endUpdate() are cleared */
+        void _beginUpdate()
+        {
+            for (const Position &pos : dirtyCells)
             {
-                for (int x = 0; x < width; x++)
-                {
-                    map[y][x] = Cell(x, y);
-                }
+                dirtyFlags[getIndex(pos.x, pos.y)] = 0;
             }
+            dirtyCells.clear();
+            generation++;
         }
 
-        Cell const *getCellByPos(const Position &pos) const
+        void _setResource(const ResourceType &type, int x, int y, int amount)
         {
-            return &map[pos.y][pos.x];
+            int idx = getIndex(x, y);
+            resourceSeen[idx] = generation;
+            if (resourceAmount[idx] != amount || resourceType[idx] != type)
+            {
+                markDirty(x, y, RESOURCE_CHANGED);
+                resourceAmount[idx] = amount;
+                resourceType[idx] = type;
+            }
         }
 
-        Cell const *getCell(int x, int y) const
+        void _setRoad(int x, int y, float road)
         {
-            return &map[y][x];
+            int idx = getIndex(x, y);
+            roadSeen[idx] = generation;
+            if (this->road[idx] != road)
+            {
+                markDirty(x, y, ROAD_CHANGED);
+                this->road[idx] = road;
+            }
         }
 
-        Cell *getCellByPos(const Position &pos)
+        void _setCityTile(int x, int y, const CityTileHandle &citytile)
         {
-            return &map[pos.y][pos.x];
+            int idx = getIndex(x, y);
+            citytileSeen[idx] = generation;
+            if (citytileTeam[idx] != citytile.team)
+            {
+                markDirty(x, y, CITYTILE_CHANGED);
+                citytileTeam[idx] = citytile.team;
+            }
+            citytileCity[idx] = citytile.city;
+            citytileIndex[idx] = citytile.tile;
         }
 
-        Cell *getCell(int x, int y)
+        /** Clears whatever was not reported by the update that just finished */
+        void _endUpdate()
         {
-            return &map[y][x];
+            int size = width * height;
+            for (int idx = 0; idx < size; idx++)
+            {
+                if (resourceSeen[idx] != generation && resourceAmount[idx] != -1)
+                {
+                    markDirty(idx % width, idx / width, RESOURCE_CHANGED | RESOURCE_DEPLETED);
+                    resourceAmount[idx] = -1;
+                }
+                if (roadSeen[idx] != generation && road[idx] != 0)
+                {
+                    markDirty(idx % width, idx / width, ROAD_CHANGED);
+                    road[idx] = 0;
+                }
+                if (citytileSeen[idx] != generation && citytileTeam[idx] != -1)
+                {
+                    markDirty(idx % width, idx / width, CITYTILE_CHANGED);
+                    citytileTeam[idx] = -1;
+                    citytileCity[idx] = -1;
+                    citytileIndex[idx] = -1;
+                }
+            }
         }
 
-        void _setResource(const ResourceType &type, int x, int y, int amount)
+    private:
+        int generation = 0;
+        vector<int> dirtyFlags;
+        vector<int> resourceSeen;
+        vector<int> roadSeen;
+        vector<int> citytileSeen;
+
+        void markDirty(int x, int y, int flags)
         {
-            Cell *cell = getCell(x, y);
-            cell->resource = Resource();
-            cell->resource.amount = amount;
-            cell->resource.type = type;
+            int &cellFlags = dirtyFlags[getIndex(x, y)];
+            if (cellFlags == 0)
+            {
+                dirtyCells.emplace_back(x, y);
+            }
+            cellFlags |= flags;
         }
     };
 
@@ -0,0 +1,376 @@
+#ifndef resource_clusters_h
+#define resource_clusters_h
+#include <utility>
+#include <vector>
+#include "map.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+#include "resource_index.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /** A 4-connected group of resource cells of one type and what it adds up to */
+    struct ResourceCluster
+    {
+        ResourceType type = ResourceType::wood;
+        int cellCount = 0;
+        int amount = 0;
+        /** amount turned into fuel at the rate of the type */
+        int fuel = 0;
+        /** Mean of the cells, rounded down */
+        Position centroid;
+        Bitboard cells;
+        /** Cells next to the cluster that hold no resource, where a city tile would collect from it */
+        Bitboard perimeter;
+        /** Units sent to one of its cells, as given by the strategy through ResourceClusters::assignUnit(), see forEachUnit() */
+        int unitCount = 0;
+        int sumX = 0;
+        int sumY = 0;
+    };
+
+    /**
+     * Resource cells grouped into clusters by a union-find, kept up to date by kit::Agent::update() from the dirty cells.
+     * New cells join the clusters next to them. A depleted cell may split its cluster, so that cluster alone is taken
+     * apart and its remaining cells joined again. Totals, centroid and perimeter are cached per cluster, which is known
+     * by the index of its root cell. The cells and the units of a cluster are linked lists threaded through arrays
+     * sized once per map, so merging two clusters is a splice and a turn allocates nothing.
+     */
+    class ResourceClusters
+    {
+    public:
+        void reset(int width, int height)
+        {
+            this->width = width;
+            this->height = height;
+            int size = width * height;
+            parent.assign(size, -1);
+            slots.assign(size, -1);
+            amounts.assign(size, 0);
+            nextCell.assign(size, -1);
+            firstCell.assign(size, -1);
+            lastCell.assign(size, -1);
+            firstUnit.assign(size, -1);
+            lastUnit.assign(size, -1);
+            unitUids.clear();
+            unitUids.reserve(size);
+            nextUnit.clear();
+            nextUnit.reserve(size);
+            clusters.assign(size, ResourceCluster());
+            broken.assign(size, 0);
+            remaining.reserve(size);
+            brokenRoots.reserve(size);
+            resources.clear();
+            ids.clear();
+            ids.reserve(size);
+        }
+
+        /** Cluster of the cell, -1 if it holds no resource */
+        int getClusterId(int x, int y) const
+        {
+            return parent[y * width + x];
+        }
+
+        const ResourceCluster &get(int id) const
+        {
+            return clusters[id];
+        }
+
+        /** Calls f(idx) with the index of every cell of a cluster, in no particular order */
+        template <class F>
+        void forEachCell(int id, F f) const
+        {
+            for (int idx = firstCell[id]; idx != -1; idx = nextCell[idx])
+            {
+                f(idx);
+            }
+        }
+
+        /** Calls f(uid) for every unit assigned to a cluster since the last clearUnits() */
+        template <class F>
+        void forEachUnit(int id, F f) const
+        {
+            for (int entry = firstUnit[id]; entry != -1; entry = nextUnit[entry])
+            {
+                f(unitUids[entry]);
+            }
+        }
+
+        /** Every cluster, smallest root cell first */
+        const vector<int> &getIds() const
+        {
+            return ids;
+        }
+
+        /** Forgets the units of every cluster, before the strategy hands out this turn's targets */
+        void clearUnits()
+        {
+            for (int id : ids)
+            {
+                clearUnits(id);
+            }
+            unitUids.clear();
+            nextUnit.clear();
+        }
+
+        /** Records that unit uid is heading for the resource cell pos */
+        void assignUnit(int uid, const Position &pos)
+        {
+            int id = getClusterId(pos.x, pos.y);
+            if (id == -1)
+                return;
+            int entry = unitUids.size();
+            unitUids.push_back(uid);
+            nextUnit.push_back(-1);
+            if (firstUnit[id] == -1)
+                firstUnit[id] = entry;
+            else
+                nextUnit[lastUnit[id]] = entry;
+            lastUnit[id] = entry;
+            clusters[id].unitCount++;
+        }
+
+        void _applyDirtyCells(const GameMap &map)
+        {
+            bool reshaped = false;
+            brokenRoots.clear();
+            // cells that left first, so the clusters they split are rebuilt before new cells join anything
+            for (const Position &pos : map.dirtyCells)
+            {
+                if (!(map.getDirtyFlags(pos.x, pos.y) & RESOURCE_CHANGED))
+                    continue;
+                int idx = map.getIndex(pos.x, pos.y);
+                int slot = map.resourceAmount[idx] > 0 ? ResourceIndex::getTypeSlot(map.resourceType[idx]) : -1;
+                if (parent[idx] == -1)
+                    continue;
+                int root = find(idx);
+                if (slot == slots[idx])
+                {
+                    clusters[root].amount += map.resourceAmount[idx] - amounts[idx];
+                    amounts[idx] = map.resourceAmount[idx];
+                    continue;
+                }
+                clusters[root].amount -= amounts[idx];
+                amounts[idx] = 0;
+                slots[idx] = -1;
+                resources.reset(pos);
+                reshaped = true;
+                if (!broken[root])
+                {
+                    broken[root] = 1;
+                    brokenRoots.push_back(root);
+                }
+            }
+            for (int root : brokenRoots)
+            {
+                rebuild(root);
+            }
+            for (const Position &pos : map.dirtyCells)
+            {
+                int idx = map.getIndex(pos.x, pos.y);
+                if (!(map.getDirtyFlags(pos.x, pos.y) & RESOURCE_CHANGED) || parent[idx] != -1 || map.resourceAmount[idx] <= 0)
+                    continue;
+                add(idx, ResourceIndex::getTypeSlot(map.resourceType[idx]), map.resourceAmount[idx]);
+                reshaped = true;
+            }
+
+            if (reshaped)
+                refreshShapes();
+            for (int id : ids)
+            {
+                clusters[id].fuel = clusters[id].amount * fuelRate(clusters[id].type);
+            }
+        }
+
+    private:
+        int width = 0;
+        int height = 0;
+        /** Union-find parent of each resource cell, -1 where there is none; every cell points at its root between updates */
+        vector<int> parent;
+        /** ResourceIndex type slot of each cell, -1 where there is no resource */
+        vector<char> slots;
+        vector<int> amounts;
+        /** Next cell of the same cluster, -1 after the last one, and the ends of the list of each cluster by root */
+        vector<int> nextCell;
+        vector<int> firstCell;
+        vector<int> lastCell;
+        /** Units assigned this turn, linked per cluster through nextUnit from firstUnit of its root */
+        vector<int> unitUids;
+        vector<int> nextUnit;
+        vector<int> firstUnit;
+        vector<int> lastUnit;
+        /** Statistics of each cluster, by root */
+        vector<ResourceCluster> clusters;
+        vector<int> ids;
+        Bitboard resources;
+        /** Roots of the clusters that lost a cell in the update in progress */
+        vector<char> broken;
+        vector<int> brokenRoots;
+        vector<int> remaining;
+
+        static int fuelRate(const ResourceType &type)
+        {
+            switch (type)
+            {
+            case ResourceType::coal:
+                return GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.COAL;
+            case ResourceType::uranium:
+                return GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.URANIUM;
+            default:
+                return GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.WOOD;
+            }
+        }
+
+        static ResourceType slotType(int slot)
+        {
+            return slot == 1 ? ResourceType::coal : (slot == 2 ? ResourceType::uranium : ResourceType::wood);
+        }
+
+        int find(int idx)
+        {
+            int root = idx;
+            while (parent[root] != root)
+            {
+                root = parent[root];
+            }
+            while (parent[idx] != root)
+            {
+                int next = parent[idx];
+                parent[idx] = root;
+                idx = next;
+            }
+            return root;
+        }
+
+        /** Makes idx a cluster of its own */
+        void makeSingle(int idx, int slot, int amount)
+        {
+            int x = idx % width, y = idx / width;
+            parent[idx] = idx;
+            slots[idx] = slot;
+            amounts[idx] = amount;
+            nextCell[idx] = -1;
+            firstCell[idx] = idx;
+            lastCell[idx] = idx;
+            ResourceCluster &cluster = clusters[idx];
+            cluster.type = slotType(slot);
+            cluster.cellCount = 1;
+            cluster.amount = amount;
+            cluster.sumX = x;
+            cluster.sumY = y;
+            cluster.cells.clear();
+            cluster.cells.set(x, y);
+            clearUnits(idx);
+        }
+
+        void clearUnits(int root)
+        {
+            firstUnit[root] = -1;
+            lastUnit[root] = -1;
+            clusters[root].unitCount = 0;
+        }
+
+        /** Appends the list of root rb to that of root ra and leaves rb's empty, for lists threaded through next */
+        static void splice(vector<int> &next, vector<int> &first, vector<int> &last, int ra, int rb)
+        {
+            if (first[rb] == -1)
+                return;
+            if (first[ra] == -1)
+                first[ra] = first[rb];
+            else
+                next[last[ra]] = first[rb];
+            last[ra] = last[rb];
+            first[rb] = -1;
+            last[rb] = -1;
+        }
+
+        /** Merges the clusters of a and b, the smaller one into the larger */
+        void unite(int a, int b)
+        {
+            int ra = find(a), rb = find(b);
+            if (ra == rb)
+                return;
+            if (clusters[ra].cellCount < clusters[rb].cellCount)
+                swap(ra, rb);
+            parent[rb] = ra;
+            ResourceCluster &into = clusters[ra];
+            ResourceCluster &from = clusters[rb];
+            into.cellCount += from.cellCount;
+            into.amount += from.amount;
+            into.sumX += from.sumX;
+            into.sumY += from.sumY;
+            into.cells |= from.cells;
+            into.unitCount += from.unitCount;
+            from.unitCount = 0;
+            splice(nextCell, firstCell, lastCell, ra, rb);
+            splice(nextUnit, firstUnit, lastUnit, ra, rb);
+        }
+
+        /** Joins idx to the cells of the same type next to it */
+        void joinNeighbours(int idx)
+        {
+            int x = idx % width, y = idx / width;
+            const int around[4] = {x > 0 ? idx - 1 : -1, y + 1 < height ? idx + width : -1, x + 1 < width ? idx + 1 : -1, y > 0 ? idx - width : -1};
+            for (int n : around)
+            {
+                if (n != -1 && parent[n] != -1 && slots[n] == slots[idx])
+                    unite(idx, n);
+            }
+        }
+
+        void add(int idx, int slot, int amount)
+        {
+            makeSingle(idx, slot, amount);
+            resources.set(idx % width, idx / width);
+            joinNeighbours(idx);
+        }
+
+        /** Takes the cluster of root apart and joins its cells that still hold a resource again */
+        void rebuild(int root)
+        {
+            broken[root] = 0;
+            remaining.clear();
+            forEachCell(root, [&](int idx)
+                        { remaining.push_back(idx); });
+            for (int idx : remaining)
+            {
+                if (slots[idx] == -1)
+                {
+                    parent[idx] = -1;
+                    firstCell[idx] = -1;
+                    lastCell[idx] = -1;
+                }
+                else
+                    makeSingle(idx, slots[idx], amounts[idx]);
+            }
+            for (int idx : remaining)
+            {
+                if (slots[idx] != -1)
+                    joinNeighbours(idx);
+            }
+        }
+
+        /** Flattens the union-find and recomputes the list of clusters, their centroids and their perimeters */
+        void refreshShapes()
+        {
+            ids.clear();
+            for (int idx = 0; idx < width * height; idx++)
+            {
+                if (parent[idx] == -1)
+                    continue;
+                parent[idx] = find(idx);
+                if (parent[idx] == idx)
+                    ids.push_back(idx);
+            }
+            for (int id : ids)
+            {
+                ResourceCluster &cluster = clusters[id];
+                cluster.centroid = Position(cluster.sumX / cluster.cellCount, cluster.sumY / cluster.cellCount);
+                cluster.perimeter = cluster.cells.neighbors(width, height).andNot(resources);
+            }
+        }
+    };
+}
+
+#endif
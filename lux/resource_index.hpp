@@ -0,0 +1,192 @@
+#ifndef resource_index_h
+#define resource_index_h
+#include <cstdint>
+#include <vector>
+#include "map.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * Resource cells bucketed by type and by 4x4 tile of the map, kept up to date by kit::Agent::update()
+     * from the dirty cells, so nearest-resource queries only open the tiles that can still beat the best hit.
+     */
+    class ResourceIndex
+    {
+    public:
+        static constexpr int BUCKET_SIZE = 4;
+        static constexpr int TYPE_COUNT = 3;
+
+        /** Slot of a resource type in the per-type arrays: wood, coal, uranium */
+        static int getTypeSlot(const ResourceType &type)
+        {
+            switch (type)
+            {
+            case ResourceType::coal:
+                return 1;
+            case ResourceType::uranium:
+                return 2;
+            default:
+                return 0;
+            }
+        }
+
+        void reset(int width, int height)
+        {
+            this->width = width;
+            this->height = height;
+            bucketsX = (width + BUCKET_SIZE - 1) / BUCKET_SIZE;
+            bucketsY = (height + BUCKET_SIZE - 1) / BUCKET_SIZE;
+            for (int slot = 0; slot < TYPE_COUNT; slot++)
+            {
+                buckets[slot].assign(bucketsX * bucketsY, 0);
+                counts[slot] = 0;
+            }
+        }
+
+        /** Number of cells currently holding the type */
+        int count(const ResourceType &type) const
+        {
+            return counts[getTypeSlot(type)];
+        }
+
+        void _applyDirtyCells(const GameMap &map)
+        {
+            for (const Position &pos : map.dirtyCells)
+            {
+                if (map.getDirtyFlags(pos.x, pos.y) & RESOURCE_CHANGED)
+                    _updateCell(map, pos.x, pos.y);
+            }
+        }
+
+        void _updateCell(const GameMap &map, int x, int y)
+        {
+            int idx = map.getIndex(x, y);
+            int bucket = (y / BUCKET_SIZE) * bucketsX + x / BUCKET_SIZE;
+            uint16_t bit = 1u << ((y % BUCKET_SIZE) * BUCKET_SIZE + x % BUCKET_SIZE);
+            int present = map.resourceAmount[idx] > 0 ? getTypeSlot(map.resourceType[idx]) : -1;
+            for (int slot = 0; slot < TYPE_COUNT; slot++)
+            {
+                bool wasSet = buckets[slot][bucket] & bit;
+                if (slot == present && !wasSet)
+                {
+                    buckets[slot][bucket] |= bit;
+                    counts[slot]++;
+                }
+                else if (slot != present && wasSet)
+                {
+                    buckets[slot][bucket] &= ~bit;
+                    counts[slot]--;
+                }
+            }
+        }
+
+        /**
+         * Closest resource cell to from that holds more than minAmount and is not claimed.
+         * Only types with a positive weight are considered and the Manhattan distance is multiplied by the weight
+         * of the cell's type, ties go to the first cell in row-major order. Returns (-1, -1) if nothing qualifies.
+         */
+        Position findNearest(const Position &from, const GameMap &map, const int weights[TYPE_COUNT], int minAmount, const Bitboard &claimed) const
+        {
+            return findNearest(from, map, weights, minAmount, claimed, [&](int x, int y)
+                               { return abs(x - from.x) + abs(y - from.y); });
+        }
+
+        /**
+         * The same with distance(x, y) from `from` in place of the Manhattan distance, negative where a cell cannot be reached.
+         * It must never be shorter than the Manhattan distance, which still bounds the tiles left to open.
+         */
+        template <class Distance>
+        Position findNearest(const Position &from, const GameMap &map, const int weights[TYPE_COUNT], int minAmount, const Bitboard &claimed, Distance distance) const
+        {
+            int minWeight = 0;
+            for (int slot = 0; slot < TYPE_COUNT; slot++)
+            {
+                if (weights[slot] > 0 && counts[slot] > 0 && (minWeight == 0 || weights[slot] < minWeight))
+                    minWeight = weights[slot];
+            }
+            if (minWeight == 0)
+                return Position(-1, -1);
+
+            int bestScore = -1;
+            int bestIdx = -1;
+            const int centerX = from.x / BUCKET_SIZE;
+            const int centerY = from.y / BUCKET_SIZE;
+            const int maxRing = max(max(centerX, bucketsX - 1 - centerX), max(centerY, bucketsY - 1 - centerY));
+            for (int ring = 0; ring <= maxRing; ring++)
+            {
+                // no cell of this ring or beyond is closer than this
+                int ringBound = ring == 0 ? 0 : (ring - 1) * BUCKET_SIZE + 1;
+                if (bestScore != -1 && ringBound * minWeight > bestScore)
+                    break;
+                for (int by = centerY - ring; by <= centerY + ring; by++)
+                {
+                    if (by < 0 || by >= bucketsY)
+                        continue;
+                    bool edgeRow = by == centerY - ring || by == centerY + ring;
+                    for (int bx = centerX - ring; bx <= centerX + ring; bx += edgeRow ? 1 : 2 * ring)
+                    {
+                        if (bx >= 0 && bx < bucketsX)
+                            searchBucket(from, map, weights, minAmount, claimed, distance, bx, by, bestScore, bestIdx);
+                        if (ring == 0)
+                            break;
+                    }
+                }
+            }
+            if (bestIdx == -1)
+                return Position(-1, -1);
+            return Position(bestIdx % width, bestIdx / width);
+        }
+
+    private:
+        int width = 0;
+        int height = 0;
+        int bucketsX = 0;
+        int bucketsY = 0;
+        /** Per type and bucket, bit (y % 4) * 4 + x % 4 is set when that cell holds the type */
+        vector<uint16_t> buckets[TYPE_COUNT];
+        int counts[TYPE_COUNT] = {};
+
+        template <class Distance>
+        void searchBucket(const Position &from, const GameMap &map, const int weights[TYPE_COUNT], int minAmount, const Bitboard &claimed,
+                          Distance &distance, int bx, int by, int &bestScore, int &bestIdx) const
+        {
+            int bucket = by * bucketsX + bx;
+            int x0 = bx * BUCKET_SIZE;
+            int y0 = by * BUCKET_SIZE;
+            int dx = from.x < x0 ? x0 - from.x : (from.x >= x0 + BUCKET_SIZE ? from.x - (x0 + BUCKET_SIZE - 1) : 0);
+            int dy = from.y < y0 ? y0 - from.y : (from.y >= y0 + BUCKET_SIZE ? from.y - (y0 + BUCKET_SIZE - 1) : 0);
+            int bound = dx + dy;
+            for (int slot = 0; slot < TYPE_COUNT; slot++)
+            {
+                uint32_t bits = buckets[slot][bucket];
+                if (weights[slot] <= 0 || bits == 0 || (bestScore != -1 && bound * weights[slot] > bestScore))
+                    continue;
+                while (bits != 0)
+                {
+                    int bit = __builtin_ctz(bits);
+                    bits &= bits - 1;
+                    int x = x0 + bit % BUCKET_SIZE;
+                    int y = y0 + bit / BUCKET_SIZE;
+                    int idx = map.getIndex(x, y);
+                    if (map.resourceAmount[idx] <= minAmount || claimed.test(x, y))
+                        continue;
+                    int steps = distance(x, y);
+                    if (steps < 0)
+                        continue;
+                    int score = steps * weights[slot];
+                    if (bestScore == -1 || score < bestScore || (score == bestScore && idx < bestIdx))
+                    {
+                        bestScore = score;
+                        bestIdx = idx;
+                    }
+                }
+            }
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,1192 @@
+#ifndef simulator_h
+#define simulator_h
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "kit.hpp"
+#include "snapshot.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * The Lux AI 2021 rules played forward in process, on the same GameMap and Player objects kit::Agent decodes into.
+     * step() takes the command lines both agents printed and applies a whole turn the way the lux-ai-2021 engine does:
+     * validation, movement with collisions, city tile and unit actions, collection, deposits, night upkeep, depletion,
+     * wood regrowth and cooldowns. writeState() gives back the update block an agent reads, so a kit::Agent can be fed
+     * from it directly.
+     * The map, road and city tile layers of map are kept the way the update protocol reports them: roads are MAX_ROAD
+     * under city tiles and CityTileHandle indices follow Player::cities.
+     */
+    class Simulator
+    {
+    public:
+        GameMap map;
+        Player players[2] = {Player(0), Player(1)};
+        /** The turn the state is at, the one the next step() plays */
+        int turn = 0;
+        /** Commands the rules turned down since reset(), lines that are no command at all included */
+        int rejectedCommands = 0;
+        /** Numbers of the next unit and city ids, load() can only guess them from the ids still in play */
+        int nextUnitId = 1;
+        int nextCityId = 1;
+
+        /** Starts an empty width x height game at turn 0, fill it with setResource(), spawnCityTile() and spawnUnit() */
+        void reset(int width, int height)
+        {
+            map = GameMap(width, height);
+            players[0] = Player(0);
+            players[1] = Player(1);
+            reserve(width * height);
+            turn = 0;
+            rejectedCommands = 0;
+            nextUnitId = 1;
+            nextCityId = 1;
+        }
+
+        /**
+         * Starts from an update block as an agent reads it, from the rp lines to D_DONE, of a width x height game at turn.
+         * Unit and city ids keep counting after the largest ones in the block.
+         */
+        void load(string_view block, int width, int height, int turn)
+        {
+            reset(width, height);
+            this->turn = turn;
+            kit::Tokenizer lines(block, '\n');
+            while (!lines.done())
+            {
+                kit::Tokenizer parts(lines.next());
+                string_view kind = parts.next();
+                if (kind == "rp")
+                {
+                    int team = parts.nextInt();
+                    players[team].researchPoints = parts.nextInt();
+                }
+                else if (kind == "r")
+                {
+                    ResourceType type = ResourceType(parts.next()[0]);
+                    int x = parts.nextInt();
+                    int y = parts.nextInt();
+                    setResource(type, x, y, parts.nextInt());
+                }
+                else if (kind == "u")
+                {
+                    int type = parts.nextInt();
+                    int team = parts.nextInt();
+                    string_view id = parts.next();
+                    int x = parts.nextInt();
+                    int y = parts.nextInt();
+                    float cooldown = parts.nextFloat();
+                    int wood = parts.nextInt();
+                    int coal = parts.nextInt();
+                    int uranium = parts.nextInt();
+                    int uid = kit::parseId(id);
+                    players[team].units.emplace_back(team, type, string(id), uid, x, y, cooldown, wood, coal, uranium);
+                    nextUnitId = max(nextUnitId, uid + 1);
+                }
+                else if (kind == "c")
+                {
+                    int team = parts.nextInt();
+                    string_view id = parts.next();
+                    City &city = findOrAddCity(team, id);
+                    city.fuel = parts.nextFloat();
+                    city.lightUpkeep = parts.nextFloat();
+                }
+                else if (kind == "ct")
+                {
+                    int team = parts.nextInt();
+                    City &city = findOrAddCity(team, parts.next());
+                    int x = parts.nextInt();
+                    int y = parts.nextInt();
+                    city.addCityTile(x, y, parts.nextFloat());
+                }
+                else if (kind == "ccd")
+                {
+                    int x = parts.nextInt();
+                    int y = parts.nextInt();
+                    map.road[map.getIndex(x, y)] = parts.nextFloat();
+                }
+            }
+            rebuildCities();
+        }
+
+        /** Packs the state into snapshot, with the id counters, false if it does not fit, see GameStateSnapshot::capture() */
+        bool save(GameStateSnapshot &snapshot) const
+        {
+            if (!snapshot.capture(map, players, turn))
+                return false;
+            snapshot.nextUnitId = nextUnitId;
+            snapshot.nextCityId = nextCityId;
+            return true;
+        }
+
+        /**
+         * Starts from a snapshot taken by save() or GameStateSnapshot::capture(). The map, the units and the city
+         * entries keep their buffers, so restoring a state no larger than the current one allocates nothing.
+         * Cities take the light upkeep the snapshot holds.
+         */
+        void restore(const GameStateSnapshot &snapshot)
+        {
+            if (map.width != snapshot.width || map.height != snapshot.height)
+            {
+                map = GameMap(snapshot.width, snapshot.height);
+                reserve(snapshot.width * snapshot.height);
+            }
+            int size = snapshot.width * snapshot.height;
+            for (int idx = 0; idx < size; idx++)
+            {
+                map.resourceType[idx] = snapshot.resourceType[idx];
+                map.resourceAmount[idx] = snapshot.resourceAmount[idx];
+                map.road[idx] = snapshot.getRoad(idx);
+                map.citytileTeam[idx] = -1;
+                map.citytileCity[idx] = -1;
+                map.citytileIndex[idx] = -1;
+            }
+            turn = snapshot.turn;
+            rejectedCommands = 0;
+            nextUnitId = snapshot.nextUnitId;
+            nextCityId = snapshot.nextCityId;
+
+            const GameStateSnapshot::UnitEntry *unit = snapshot.units;
+            const GameStateSnapshot::CityEntry *city = snapshot.cities;
+            char id[16];
+            for (int team = 0; team < 2; team++)
+            {
+                Player &player = players[team];
+                player._beginUpdate();
+                player.researchPoints = snapshot.researchPoints[team];
+                for (const GameStateSnapshot::UnitEntry *end = unit + snapshot.unitCount[team]; unit != end; unit++)
+                {
+                    string_view unitid = GameStateSnapshot::writeId(id, 'u', unit->uid);
+                    player.units.emplace_back(team, unit->type, string(unitid), unit->uid, unit->x, unit->y, unit->cooldown, unit->wood, unit->coal, unit->uranium);
+                }
+                for (const GameStateSnapshot::CityEntry *end = city + snapshot.cityCount[team]; city != end; city++)
+                {
+                    if (city->tileCount == 0)
+                        continue;
+                    City &restored = player._getReportedCity(city->uid, GameStateSnapshot::writeId(id, 'c', city->uid));
+                    restored.fuel = city->fuel;
+                    restored.lightUpkeep = city->lightUpkeep;
+                    for (int i = city->firstTile; i < city->firstTile + city->tileCount; i++)
+                    {
+                        const GameStateSnapshot::CityTileEntry &tile = snapshot.cityTiles[i];
+                        int idx = map.getIndex(tile.x, tile.y);
+                        map.citytileTeam[idx] = team;
+                        map.citytileCity[idx] = restored.index;
+                        map.citytileIndex[idx] = restored.citytiles.size();
+                        restored.addCityTile(tile.x, tile.y, tile.cooldown);
+                        player.cityTileCount++;
+                    }
+                }
+                player._endUpdate();
+            }
+        }
+
+        /**
+         * Starts a width x height game on a random map drawn from seed, mirrored left to right like the CLI's maps:
+         * forests, a few coal fields and uranium deposits grown as random walks, and each team's city tile and worker
+         * on mirrored free cells close to wood. The same seed always gives the same map.
+         */
+        void generate(uint32_t seed, int width, int height)
+        {
+            reset(width, height);
+            mt19937 rng(seed);
+            const int half = width / 2;
+            auto random = [&rng](int low, int high)
+            {
+                return low + (int)(rng() % (uint32_t)(high - low + 1));
+            };
+            auto grow = [&](const ResourceType &type, int cells, int minAmount, int maxAmount)
+            {
+                Position pos(random(0, half - 1), random(0, height - 1));
+                for (int i = 0; i < cells; i++)
+                {
+                    if (map.resourceAmount[map.getIndex(pos.x, pos.y)] <= 0)
+                        setResource(type, pos.x, pos.y, random(minAmount, maxAmount));
+                    Position next = pos.translate(ALL_DIRECTIONS[random(0, 3)], 1);
+                    if (next.x >= 0 && next.x < half && next.y >= 0 && next.y < height)
+                        pos = next;
+                }
+            };
+            const int area = half * height;
+            for (int i = 0; i < max(2, area / 30); i++)
+            {
+                grow(ResourceType::wood, random(3, 10), 200, 500);
+            }
+            for (int i = 0; i < 1 + area / 120; i++)
+            {
+                grow(ResourceType::coal, random(3, 7), 200, 400);
+            }
+            for (int i = 0; i < 1 + area / 240; i++)
+            {
+                grow(ResourceType::uranium, random(2, 4), 200, 350);
+            }
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < half; x++)
+                {
+                    int idx = map.getIndex(x, y);
+                    setResource(map.resourceType[idx], width - 1 - x, y, map.resourceAmount[idx]);
+                }
+            }
+
+            // a free cell with wood at most two steps away, or any free cell if a few hundred draws find none
+            Position start;
+            for (int attempt = 0; attempt < 1000 && start.x == -1; attempt++)
+            {
+                Position pos(random(0, half - 1), random(0, height - 1));
+                if (map.resourceAmount[map.getIndex(pos.x, pos.y)] > 0)
+                    continue;
+                for (int y = max(0, pos.y - 2); y <= min(height - 1, pos.y + 2); y++)
+                {
+                    for (int x = max(0, pos.x - 2); x <= min(half - 1, pos.x + 2); x++)
+                    {
+                        int idx = map.getIndex(x, y);
+                        if (pos.distanceTo(Position(x, y)) <= 2 && map.resourceAmount[idx] > 0 && map.resourceType[idx] == ResourceType::wood)
+                            start = pos;
+                    }
+                }
+                if (attempt >= 500 && start.x == -1)
+                    start = pos;
+            }
+            if (start.x == -1)
+            {
+                start = Position(0, 0);
+                setResource(ResourceType::wood, 0, 0, 0);
+                setResource(ResourceType::wood, width - 1, 0, 0);
+            }
+            for (int team = 0; team < 2; team++)
+            {
+                int x = team == 0 ? start.x : width - 1 - start.x;
+                spawnCityTile(team, x, start.y);
+                spawnUnit(team, 0, x, start.y);
+            }
+        }
+
+        void setResource(const ResourceType &type, int x, int y, int amount)
+        {
+            int idx = map.getIndex(x, y);
+            map.resourceType[idx] = type;
+            map.resourceAmount[idx] = amount > 0 ? amount : -1;
+        }
+
+        /** Builds a city tile for team, joining and merging the team's cities next to it */
+        void spawnCityTile(int team, int x, int y)
+        {
+            Player &player = players[team];
+            int joined[4];
+            int joinedCount = 0;
+            const DIRECTIONS order[4] = {NORTH, EAST, SOUTH, WEST};
+            for (DIRECTIONS dir : order)
+            {
+                Position next = Position(x, y).translate(dir, 1);
+                if (!map.inBounds(next.x, next.y))
+                    continue;
+                const City *city = player.getCity(map.getCityTileHandle(next.x, next.y));
+                if (city != nullptr && find(joined, joined + joinedCount, city->uid) == joined + joinedCount)
+                    joined[joinedCount++] = city->uid;
+            }
+
+            if (joinedCount == 0)
+            {
+                // the player's update is closed, so a city it has not seen yet comes after the others
+                char id[16];
+                City &city = player._getReportedCity(nextCityId, GameStateSnapshot::writeId(id, 'c', nextCityId));
+                nextCityId++;
+                city.addCityTile(x, y, 0);
+            }
+            else
+            {
+                City &into = *findCity(team, joined[0]);
+                into.addCityTile(x, y, 0);
+                for (int i = 1; i < joinedCount; i++)
+                {
+                    City &from = *findCity(team, joined[i]);
+                    for (const CityTile &tile : from.citytiles)
+                    {
+                        into.addCityTile(tile.pos.x, tile.pos.y, tile.cooldown);
+                    }
+                    into.fuel += from.fuel;
+                    from.citytiles.clear();
+                }
+            }
+            map.road[map.getIndex(x, y)] = GAME_PARAMETERS.MAX_ROAD;
+            rebuildCities();
+        }
+
+        /** Adds a unit of type, 0 for a worker and 1 for a cart, with the next id and no cargo nor cooldown */
+        Unit &spawnUnit(int team, int type, int x, int y)
+        {
+            int uid = nextUnitId++;
+            players[team].units.emplace_back(team, type, "u_" + to_string(uid), uid, x, y, 0, 0, 0, 0);
+            return players[team].units.back();
+        }
+
+        bool isNight() const
+        {
+            return turn % GAME_PARAMETERS.getCycleLength() >= GAME_PARAMETERS.DAY_LENGTH;
+        }
+
+        /** Whether the match is finished: the last turn was played or a team has neither units nor city tiles left */
+        bool isOver() const
+        {
+            if (turn >= GAME_PARAMETERS.MAX_DAYS)
+                return true;
+            for (const Player &player : players)
+            {
+                if (player.units.empty() && player.cityTileCount == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        /** Team ahead by city tiles, then by units, -1 on a tie */
+        int getLeader() const
+        {
+            for (int criterion = 0; criterion < 2; criterion++)
+            {
+                int a = criterion == 0 ? players[0].cityTileCount : players[0].units.size();
+                int b = criterion == 0 ? players[1].cityTileCount : players[1].units.size();
+                if (a != b)
+                    return a > b ? 0 : 1;
+            }
+            return -1;
+        }
+
+        /** Appends the two lines an agent reads before its first turn */
+        void writeHeader(int agent, string &out) const
+        {
+            out += to_string(agent);
+            out += '\n';
+            out += to_string(map.width);
+            out += ' ';
+            out += to_string(map.height);
+            out += '\n';
+        }
+
+        /** Appends the update block of the current turn, D_DONE included, in the order the engine sends it */
+        void writeState(string &out) const
+        {
+            for (const Player &player : players)
+            {
+                out += "rp ";
+                appendNumber(out, player.team);
+                out += ' ';
+                appendNumber(out, player.researchPoints);
+                out += '\n';
+            }
+            for (int idx = 0; idx < map.width * map.height; idx++)
+            {
+                if (map.resourceAmount[idx] <= 0)
+                    continue;
+                out += "r ";
+                out += resourceName(map.resourceType[idx]);
+                out += ' ';
+                appendNumber(out, idx % map.width);
+                out += ' ';
+                appendNumber(out, idx / map.width);
+                out += ' ';
+                appendNumber(out, map.resourceAmount[idx]);
+                out += '\n';
+            }
+            for (const Player &player : players)
+            {
+                for (const Unit &unit : player.units)
+                {
+                    out += "u ";
+                    appendNumber(out, unit.type);
+                    out += ' ';
+                    appendNumber(out, unit.team);
+                    out += ' ';
+                    out += unit.id;
+                    for (float value : {(float)unit.pos.x, (float)unit.pos.y, unit.cooldown, (float)unit.cargo.wood, (float)unit.cargo.coal, (float)unit.cargo.uranium})
+                    {
+                        out += ' ';
+                        appendNumber(out, value);
+                    }
+                    out += '\n';
+                }
+            }
+            for (const Player &player : players)
+            {
+                for (const City &city : player.cities)
+                {
+                    out += "c ";
+                    appendNumber(out, city.team);
+                    out += ' ';
+                    out += city.cityid;
+                    out += ' ';
+                    appendNumber(out, city.fuel);
+                    out += ' ';
+                    appendNumber(out, city.lightUpkeep);
+                    out += '\n';
+                }
+            }
+            for (const Player &player : players)
+            {
+                for (const City &city : player.cities)
+                {
+                    for (const CityTile &tile : city.citytiles)
+                    {
+                        out += "ct ";
+                        appendNumber(out, city.team);
+                        out += ' ';
+                        out += city.cityid;
+                        for (float value : {(float)tile.pos.x, (float)tile.pos.y, tile.cooldown})
+                        {
+                            out += ' ';
+                            appendNumber(out, value);
+                        }
+                        out += '\n';
+                    }
+                }
+            }
+            for (int idx = 0; idx < map.width * map.height; idx++)
+            {
+                if (map.road[idx] <= 0)
+                    continue;
+                out += "ccd ";
+                appendNumber(out, idx % map.width);
+                out += ' ';
+                appendNumber(out, idx / map.width);
+                out += ' ';
+                appendNumber(out, map.road[idx]);
+                out += '\n';
+            }
+            out += "D_DONE\n";
+        }
+
+        /**
+         * Plays the current turn with the command lines of both teams, each a comma separated list as an agent prints it.
+         * Annotations are skipped, anything else the rules do not allow is counted in rejectedCommands and ignored.
+         */
+        void step(const string_view commands[2])
+        {
+            indexUnits();
+            orders.assign(nextUnitId, Order());
+            tileOrders.assign(map.width * map.height, 0);
+            for (int team = 0; team < 2; team++)
+            {
+                unitsOrdered[team] = 0;
+                kit::Tokenizer list(commands[team], ',');
+                while (!list.done())
+                {
+                    string_view command = list.next();
+                    if (!command.empty() && command[0] != 'd' && !validate(team, command))
+                        rejectedCommands++;
+                }
+            }
+            resolveMoves();
+
+            // city tiles act first, then the units of team 0 and of team 1, each in the order they were created
+            for (Player &player : players)
+            {
+                int cityCount = player.cities.size();
+                for (int c = 0; c < cityCount; c++)
+                {
+                    for (CityTile &tile : player.cities[c].citytiles)
+                    {
+                        char order = tileOrders[map.getIndex(tile.pos.x, tile.pos.y)];
+                        if (order == 0)
+                            continue;
+                        if (order == 'r')
+                            player.researchPoints++;
+                        else
+                            spawnUnit(player.team, order == 'w' ? 0 : 1, tile.pos.x, tile.pos.y);
+                        tile.cooldown += GAME_PARAMETERS.CITY_ACTION_COOLDOWN;
+                    }
+                }
+            }
+            for (Player &player : players)
+            {
+                for (size_t i = 0; i < player.units.size(); i++)
+                {
+                    act(player.units[i]);
+                }
+            }
+            for (Player &player : players)
+            {
+                for (const Unit &unit : player.units)
+                {
+                    int idx = map.getIndex(unit.pos.x, unit.pos.y);
+                    if (unit.isCart() && map.citytileTeam[idx] == -1)
+                        map.road[idx] = min(map.road[idx] + GAME_PARAMETERS.CART_ROAD_DEVELOPMENT_RATE, (float)GAME_PARAMETERS.MAX_ROAD);
+                }
+            }
+
+            distributeResources(ResourceType::uranium);
+            distributeResources(ResourceType::coal);
+            distributeResources(ResourceType::wood);
+            depositCargo();
+            if (isNight())
+                handleNight();
+            for (int idx = 0; idx < map.width * map.height; idx++)
+            {
+                if (map.resourceAmount[idx] == 0)
+                    map.resourceAmount[idx] = -1;
+            }
+            regrowWood();
+            turn++;
+            runCooldowns();
+        }
+
+    private:
+        struct Order
+        {
+            /** 'm' move, 'b' build a city, 'p' pillage, 't' transfer, 0 for none */
+            char kind = 0;
+            DIRECTIONS direction = CENTER;
+            int target = -1;
+            ResourceType resource = ResourceType::wood;
+            int amount = 0;
+            bool reverted = false;
+        };
+
+        /** Per unit uid, the order it got this turn */
+        vector<Order> orders;
+        /** Per cell, the order of the city tile there: 'r' research, 'w' build a worker, 'c' build a cart */
+        vector<char> tileOrders;
+        /** Units each team is building this turn */
+        int unitsOrdered[2] = {};
+        /** Per unit uid, its team and index in Player::units, (-1, -1) if it is gone */
+        vector<pair<int, int>> unitSlots;
+        /** Uids listed by cell, in one buffer for all the cells, so listing them again allocates nothing once it has grown */
+        class CellLists
+        {
+        public:
+            struct Span
+            {
+                const int *first;
+                const int *last;
+
+                const int *begin() const
+                {
+                    return first;
+                }
+
+                const int *end() const
+                {
+                    return last;
+                }
+
+                size_t size() const
+                {
+                    return last - first;
+                }
+            };
+
+            /** Lists every uid that eachPair(add) passes to add(cell, uid) under its cell, in the order they come */
+            template <class EachPair>
+            void build(int cells, EachPair eachPair)
+            {
+                start.assign(cells + 1, 0);
+                eachPair([&](int cell, int)
+                         { start[cell + 1]++; });
+                for (int cell = 0; cell < cells; cell++)
+                {
+                    start[cell + 1] += start[cell];
+                }
+                count.assign(cells, 0);
+                ids.resize(start[cells]);
+                eachPair([&](int cell, int uid)
+                         { ids[start[cell] + count[cell]++] = uid; });
+            }
+
+            Span operator[](int cell) const
+            {
+                const int *first = ids.data() + start[cell];
+                return Span{first, first + count[cell]};
+            }
+
+            /** Empties the list of cell, a Span taken before still reads the uids it had */
+            void clear(int cell)
+            {
+                count[cell] = 0;
+            }
+
+            void reserve(int cells, int uids)
+            {
+                start.reserve(cells + 1);
+                count.reserve(cells);
+                ids.reserve(uids);
+            }
+
+        private:
+            vector<int> start;
+            vector<int> count;
+            vector<int> ids;
+        };
+
+        /** Per cell, the uids of the units on it, then of those moving onto it */
+        CellLists cellUnits;
+        CellLists cellMoves;
+        vector<int> moveCells;
+        vector<int> miners;
+        vector<int> requests;
+        /** The cities rebuildCities() hands back to their player, each with its range in keptTiles */
+        struct KeptCity
+        {
+            int uid;
+            float fuel;
+            int firstTile;
+            int tileCount;
+        };
+        vector<KeptCity> keptCities;
+        vector<CityTile> keptTiles;
+
+        /**
+         * Sizes the players and the buffers of a turn for a map of cells cells, so steps on it allocate nothing:
+         * units and city tiles are at most as many as cells for each team, and ids stay below Player::_idRoom()
+         */
+        void reserve(int cells)
+        {
+            for (Player &player : players)
+            {
+                player._reserve(cells);
+            }
+            int ids = Player::_idRoom(cells);
+            orders.reserve(ids);
+            unitSlots.reserve(ids);
+            tileOrders.reserve(cells);
+            cellUnits.reserve(cells, 2 * cells);
+            cellMoves.reserve(cells, 2 * cells);
+            moveCells.reserve(cells);
+            miners.reserve(2 * cells);
+            requests.reserve(2 * cells);
+            keptCities.reserve((cells + 1) / 2);
+            keptTiles.reserve(cells);
+        }
+
+        static const char *resourceName(const ResourceType &type)
+        {
+            switch (type)
+            {
+            case ResourceType::coal:
+                return "coal";
+            case ResourceType::uranium:
+                return "uranium";
+            default:
+                return "wood";
+            }
+        }
+
+        static int fuelRate(const ResourceType &type)
+        {
+            switch (type)
+            {
+            case ResourceType::coal:
+                return GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.COAL;
+            case ResourceType::uranium:
+                return GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.URANIUM;
+            default:
+                return GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.WOOD;
+            }
+        }
+
+        static int &cargoOf(Unit &unit, const ResourceType &type)
+        {
+            switch (type)
+            {
+            case ResourceType::coal:
+                return unit.cargo.coal;
+            case ResourceType::uranium:
+                return unit.cargo.uranium;
+            default:
+                return unit.cargo.wood;
+            }
+        }
+
+        /** Writes integers without a fraction and the others in their shortest form, as the engine's numbers print */
+        static void appendNumber(string &out, float value)
+        {
+            char buffer[32];
+            char *end = value == floor(value) ? to_chars(buffer, buffer + sizeof(buffer), (long)value).ptr : to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+            out.append(buffer, end - buffer);
+        }
+
+        static bool researched(const Player &player, const ResourceType &type)
+        {
+            return type == ResourceType::wood || (type == ResourceType::coal && player.researchedCoal()) || (type == ResourceType::uranium && player.researchedUranium());
+        }
+
+        City *findCity(int team, int uid)
+        {
+            for (City &city : players[team].cities)
+            {
+                if (city.uid == uid)
+                    return &city;
+            }
+            return nullptr;
+        }
+
+        City &findOrAddCity(int team, string_view id)
+        {
+            int uid = kit::parseId(id);
+            City *city = findCity(team, uid);
+            if (city != nullptr)
+                return *city;
+            players[team].cities.emplace_back(team, string(id), uid, 0, 0);
+            nextCityId = max(nextCityId, uid + 1);
+            return players[team].cities.back();
+        }
+
+        /**
+         * Drops the emptied cities and reports the others to their player again the way restore() does, which rebuilds
+         * its uid lookup, then points the city tile layers of map at the new indices and prices the light upkeep.
+         * The cities wait in keptCities and keptTiles meanwhile; the units and the city entries are left in place.
+         */
+        void rebuildCities()
+        {
+            fill(map.citytileTeam.begin(), map.citytileTeam.end(), -1);
+            fill(map.citytileCity.begin(), map.citytileCity.end(), -1);
+            fill(map.citytileIndex.begin(), map.citytileIndex.end(), -1);
+            char id[16];
+            for (Player &player : players)
+            {
+                keptCities.clear();
+                keptTiles.clear();
+                for (const City &city : player.cities)
+                {
+                    if (city.citytiles.empty())
+                        continue;
+                    keptCities.push_back(KeptCity{city.uid, city.fuel, (int)keptTiles.size(), (int)city.citytiles.size()});
+                    keptTiles.insert(keptTiles.end(), city.citytiles.begin(), city.citytiles.end());
+                }
+
+                player._beginCityUpdate();
+                for (const KeptCity &kept : keptCities)
+                {
+                    City &city = player._getReportedCity(kept.uid, GameStateSnapshot::writeId(id, 'c', kept.uid));
+                    city.fuel = kept.fuel;
+                    for (int i = kept.firstTile; i < kept.firstTile + kept.tileCount; i++)
+                    {
+                        const CityTile &tile = keptTiles[i];
+                        int idx = map.getIndex(tile.pos.x, tile.pos.y);
+                        map.citytileTeam[idx] = player.team;
+                        map.citytileCity[idx] = city.index;
+                        map.citytileIndex[idx] = city.citytiles.size();
+                        city.addCityTile(tile.pos.x, tile.pos.y, tile.cooldown);
+                        player.cityTileCount++;
+                    }
+                }
+                for (City &city : player.cities)
+                {
+                    city.lightUpkeep = lightUpkeep(city);
+                }
+                player._endUpdate();
+            }
+        }
+
+        /** CITY upkeep per tile, less the adjacency bonus for every neighbouring tile of the same city */
+        float lightUpkeep(const City &city) const
+        {
+            int neighbours = 0;
+            for (const CityTile &tile : city.citytiles)
+            {
+                for (DIRECTIONS dir : ALL_DIRECTIONS)
+                {
+                    Position next = tile.pos.translate(dir, 1);
+                    if (map.inBounds(next.x, next.y) && map.citytileTeam[map.getIndex(next.x, next.y)] == city.team && map.citytileCity[map.getIndex(next.x, next.y)] == city.index)
+                        neighbours++;
+                }
+            }
+            return city.citytiles.size() * GAME_PARAMETERS.LIGHT_UPKEEP.CITY - neighbours * GAME_PARAMETERS.CITY_ADJACENCY_BONUS;
+        }
+
+        void indexUnits()
+        {
+            unitSlots.assign(nextUnitId, make_pair(-1, -1));
+            for (Player &player : players)
+            {
+                for (int i = 0; i < (int)player.units.size(); i++)
+                {
+                    unitSlots[player.units[i].uid] = make_pair(player.team, i);
+                }
+            }
+        }
+
+        /** Lists the units of both teams in cellUnits, by the cell they are on */
+        void listUnits()
+        {
+            cellUnits.build(map.width * map.height, [&](auto add)
+                            {
+                                for (const Player &player : players)
+                                {
+                                    for (const Unit &unit : player.units)
+                                    {
+                                        add(map.getIndex(unit.pos.x, unit.pos.y), unit.uid);
+                                    }
+                                } });
+        }
+
+        /** Unit of team named id, nullptr if there is none */
+        Unit *findUnit(int team, string_view id)
+        {
+            int uid = kit::parseId(id);
+            if (uid <= 0 || uid >= (int)unitSlots.size() || unitSlots[uid].first != team)
+                return nullptr;
+            Unit &unit = players[team].units[unitSlots[uid].second];
+            return unit.id == id ? &unit : nullptr;
+        }
+
+        CityTile *findCityTile(int team, int x, int y)
+        {
+            if (!map.inBounds(x, y))
+                return nullptr;
+            CityTileHandle handle = map.getCityTileHandle(x, y);
+            return handle.team == team ? players[team].getCityTile(handle) : nullptr;
+        }
+
+        /** Records command for team if the rules allow it, returns false otherwise */
+        bool validate(int team, string_view command)
+        {
+            kit::Tokenizer parts(command);
+            string_view action = parts.next();
+            if (action == "r" || action == "bw" || action == "bc")
+            {
+                int x = parts.nextInt();
+                int y = parts.nextInt();
+                CityTile *tile = findCityTile(team, x, y);
+                if (tile == nullptr || !tile->canAct() || tileOrders[map.getIndex(x, y)] != 0)
+                    return false;
+                if (action != "r")
+                {
+                    if ((int)players[team].units.size() + unitsOrdered[team] >= players[team].cityTileCount)
+                        return false;
+                    unitsOrdered[team]++;
+                }
+                tileOrders[map.getIndex(x, y)] = action == "r" ? 'r' : action[1];
+                return true;
+            }
+
+            Unit *unit = findUnit(team, parts.next());
+            if (unit == nullptr || !unit->canAct() || orders[unit->uid].kind != 0)
+                return false;
+            Order &order = orders[unit->uid];
+            int idx = map.getIndex(unit->pos.x, unit->pos.y);
+            if (action == "m")
+            {
+                string_view direction = parts.next();
+                if (direction.size() != 1 || (direction[0] != NORTH && direction[0] != EAST && direction[0] != SOUTH && direction[0] != WEST && direction[0] != CENTER))
+                    return false;
+                Position next = unit->pos.translate((DIRECTIONS)direction[0], 1);
+                if (!map.inBounds(next.x, next.y))
+                    return false;
+                signed char owner = map.citytileTeam[map.getIndex(next.x, next.y)];
+                if (owner != -1 && owner != team)
+                    return false;
+                if (direction[0] != CENTER)
+                {
+                    order.kind = 'm';
+                    order.direction = (DIRECTIONS)direction[0];
+                }
+                return true;
+            }
+            if (action == "bcity")
+            {
+                if (!unit->isWorker() || map.resourceAmount[idx] > 0 || map.citytileTeam[idx] != -1 ||
+                    unit->cargo.wood + unit->cargo.coal + unit->cargo.uranium < GAME_PARAMETERS.CITY_BUILD_COST)
+                    return false;
+                order.kind = 'b';
+                return true;
+            }
+            if (action == "p")
+            {
+                if (!unit->isWorker() || map.citytileTeam[idx] != -1)
+                    return false;
+                order.kind = 'p';
+                return true;
+            }
+            if (action == "t")
+            {
+                Unit *destination = findUnit(team, parts.next());
+                string_view resource = parts.next();
+                int amount = parts.nextInt();
+                if (destination == nullptr || destination == unit || unit->pos.distanceTo(destination->pos) != 1 || amount <= 0)
+                    return false;
+                if (resource == "wood")
+                    order.resource = ResourceType::wood;
+                else if (resource == "coal")
+                    order.resource = ResourceType::coal;
+                else if (resource == "uranium")
+                    order.resource = ResourceType::uranium;
+                else
+                    return false;
+                order.kind = 't';
+                order.target = destination->uid;
+                order.amount = amount;
+                return true;
+            }
+            return false;
+        }
+
+        /** Takes back the move of uid, and then every move onto the cell it now stays on unless that is a city tile */
+        void revert(int uid)
+        {
+            orders[uid].reverted = true;
+            const Unit &unit = players[unitSlots[uid].first].units[unitSlots[uid].second];
+            int idx = map.getIndex(unit.pos.x, unit.pos.y);
+            if (map.citytileTeam[idx] != -1)
+                return;
+            revertMovesOnto(idx);
+        }
+
+        /** Takes back every move onto idx that still stands, each at most once since the cell's moves are cleared */
+        void revertMovesOnto(int idx)
+        {
+            CellLists::Span moves = cellMoves[idx];
+            cellMoves.clear(idx);
+            for (int uid : moves)
+            {
+                if (!orders[uid].reverted)
+                    revert(uid);
+            }
+        }
+
+        /**
+         * Cancels the moves that would leave two units on a cell that is not a city tile: moves onto the same cell,
+         * moves onto a unit that stays, and in a chain every move onto a unit whose own move was cancelled.
+         */
+        void resolveMoves()
+        {
+            int size = map.width * map.height;
+            listUnits();
+            auto eachMove = [&](auto add)
+            {
+                for (const Player &player : players)
+                {
+                    for (const Unit &unit : player.units)
+                    {
+                        if (orders[unit.uid].kind != 'm')
+                            continue;
+                        Position next = unit.pos.translate(orders[unit.uid].direction, 1);
+                        add(map.getIndex(next.x, next.y), unit.uid);
+                    }
+                }
+            };
+            cellMoves.build(size, eachMove);
+            // the cells moved onto, in the order their first move comes
+            moveCells.clear();
+            eachMove([&](int idx, int uid)
+                     {
+                         if (*cellMoves[idx].begin() == uid)
+                             moveCells.push_back(idx); });
+
+            for (int idx : moveCells)
+            {
+                if (map.citytileTeam[idx] != -1 || cellMoves[idx].size() == 0)
+                    continue;
+                bool blocked = cellMoves[idx].size() > 1;
+                for (int uid : cellUnits[idx])
+                {
+                    if (orders[uid].kind != 'm' || orders[uid].reverted)
+                        blocked = true;
+                }
+                if (!blocked)
+                    continue;
+                revertMovesOnto(idx);
+            }
+        }
+
+        void act(Unit &unit)
+        {
+            if (unit.uid >= (int)orders.size() || orders[unit.uid].kind == 0 || orders[unit.uid].reverted)
+                return;
+            const Order &order = orders[unit.uid];
+            int idx = map.getIndex(unit.pos.x, unit.pos.y);
+            switch (order.kind)
+            {
+            case 'm':
+                unit.pos = unit.pos.translate(order.direction, 1);
+                break;
+            case 'b':
+                spawnCityTile(unit.team, unit.pos.x, unit.pos.y);
+                unit.cargo = Cargo();
+                break;
+            case 'p':
+                map.road[idx] = max(map.road[idx] - GAME_PARAMETERS.PILLAGE_RATE, (float)GAME_PARAMETERS.MIN_ROAD);
+                break;
+            case 't':
+            {
+                Unit &destination = players[unit.team].units[unitSlots[order.target].second];
+                int &from = cargoOf(unit, order.resource);
+                int amount = min(order.amount, min(from, destination.getCargoSpaceLeft()));
+                from -= amount;
+                cargoOf(destination, order.resource) += amount;
+                break;
+            }
+            }
+            unit.cooldown += unit.isWorker() ? GAME_PARAMETERS.UNIT_ACTION_COOLDOWN.WORKER : GAME_PARAMETERS.UNIT_ACTION_COOLDOWN.CART;
+        }
+
+        /**
+         * Every cell of type hands its resource to the workers on it or next to it whose team researched the type,
+         * each asking for the collection rate or its free space if smaller. When the cell cannot serve them all it is
+         * shared evenly, in rounds, until it runs out or the share rounds down to nothing.
+         */
+        void distributeResources(const ResourceType &type)
+        {
+            int rate = type == ResourceType::coal ? GAME_PARAMETERS.WORKER_COLLECTION_RATE.COAL
+                                                  : (type == ResourceType::uranium ? GAME_PARAMETERS.WORKER_COLLECTION_RATE.URANIUM : GAME_PARAMETERS.WORKER_COLLECTION_RATE.WOOD);
+            indexUnits();
+            int size = map.width * map.height;
+            listUnits();
+
+            for (int idx = 0; idx < size; idx++)
+            {
+                if (map.resourceAmount[idx] <= 0 || map.resourceType[idx] != type)
+                    continue;
+                miners.clear();
+                requests.clear();
+                int x = idx % map.width, y = idx / map.width;
+                const int around[5] = {idx, y > 0 ? idx - map.width : -1, x + 1 < map.width ? idx + 1 : -1, y + 1 < map.height ? idx + map.width : -1, x > 0 ? idx - 1 : -1};
+                for (int cell : around)
+                {
+                    if (cell == -1)
+                        continue;
+                    for (int uid : cellUnits[cell])
+                    {
+                        Unit &unit = players[unitSlots[uid].first].units[unitSlots[uid].second];
+                        if (unit.isWorker() && unit.getCargoSpaceLeft() > 0 && researched(players[unit.team], type))
+                        {
+                            miners.push_back(uid);
+                            requests.push_back(min(rate, unit.getCargoSpaceLeft()));
+                        }
+                    }
+                }
+
+                int &left = map.resourceAmount[idx];
+                while (!miners.empty() && left > 0)
+                {
+                    int wanted = 0;
+                    for (int request : requests)
+                    {
+                        wanted += request;
+                    }
+                    int share = wanted <= left ? INT_MAX : left / (int)miners.size();
+                    if (share == 0)
+                        break;
+                    for (size_t i = 0; i < miners.size(); i++)
+                    {
+                        Unit &unit = players[unitSlots[miners[i]].first].units[unitSlots[miners[i]].second];
+                        int amount = min(requests[i], share);
+                        cargoOf(unit, type) += amount;
+                        requests[i] -= amount;
+                        left -= amount;
+                    }
+                    for (size_t i = miners.size(); i-- > 0;)
+                    {
+                        if (requests[i] == 0)
+                        {
+                            miners.erase(miners.begin() + i);
+                            requests.erase(requests.begin() + i);
+                        }
+                    }
+                }
+            }
+        }
+
+        /** Units on one of their city tiles turn all their cargo into fuel for that city */
+        void depositCargo()
+        {
+            for (Player &player : players)
+            {
+                for (Unit &unit : player.units)
+                {
+                    City *city = player.getCity(map.getCityTileHandle(unit.pos.x, unit.pos.y));
+                    if (city == nullptr)
+                        continue;
+                    city->fuel += unit.cargo.wood * GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.WOOD + unit.cargo.coal * GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.COAL +
+                                  unit.cargo.uranium * GAME_PARAMETERS.RESOURCE_TO_FUEL_RATE.URANIUM;
+                    unit.cargo = Cargo();
+                }
+            }
+        }
+
+        /** Cities burn their upkeep or go dark and disappear, units outside cities burn their cargo, wood first, or die */
+        void handleNight()
+        {
+            bool lost = false;
+            for (Player &player : players)
+            {
+                for (City &city : player.cities)
+                {
+                    if (city.fuel < city.lightUpkeep)
+                    {
+                        for (const CityTile &tile : city.citytiles)
+                        {
+                            map.road[map.getIndex(tile.pos.x, tile.pos.y)] = GAME_PARAMETERS.MIN_ROAD;
+                        }
+                        city.citytiles.clear();
+                        lost = true;
+                    }
+                    else
+                        city.fuel -= city.lightUpkeep;
+                }
+            }
+            if (lost)
+                rebuildCities();
+
+            for (Player &player : players)
+            {
+                auto dies = [&](Unit &unit)
+                {
+                    if (map.citytileTeam[map.getIndex(unit.pos.x, unit.pos.y)] != -1)
+                        return false;
+                    int needed = unit.isWorker() ? GAME_PARAMETERS.LIGHT_UPKEEP.WORKER : GAME_PARAMETERS.LIGHT_UPKEEP.CART;
+                    for (ResourceType type : {ResourceType::wood, ResourceType::coal, ResourceType::uranium})
+                    {
+                        int &cargo = cargoOf(unit, type);
+                        int used = min(cargo, (needed + fuelRate(type) - 1) / fuelRate(type));
+                        cargo -= used;
+                        needed -= used * fuelRate(type);
+                        if (needed <= 0)
+                            return false;
+                    }
+                    return true;
+                };
+                player.units.erase(remove_if(player.units.begin(), player.units.end(), dies), player.units.end());
+            }
+        }
+
+        void regrowWood()
+        {
+            for (int idx = 0; idx < map.width * map.height; idx++)
+            {
+                int &amount = map.resourceAmount[idx];
+                if (map.resourceType[idx] == ResourceType::wood && amount > 0 && amount < GAME_PARAMETERS.MAX_WOOD_AMOUNT)
+                    amount = (int)ceil(min(amount * GAME_PARAMETERS.WOOD_GROWTH_RATE, (float)GAME_PARAMETERS.MAX_WOOD_AMOUNT));
+            }
+        }
+
+        /** Units lose one turn of cooldown plus the road level under them, city tiles one turn */
+        void runCooldowns()
+        {
+            for (Player &player : players)
+            {
+                for (Unit &unit : player.units)
+                {
+                    unit.cooldown -= map.road[map.getIndex(unit.pos.x, unit.pos.y)];
+                    unit.cooldown = max(unit.cooldown - 1, 0.0f);
+                }
+                for (City &city : player.cities)
+                {
+                    for (CityTile &tile : city.citytiles)
+                    {
+                        tile.cooldown = max(tile.cooldown - 1, 0.0f);
+                    }
+                }
+            }
+        }
+    };
+}
+
+#endif
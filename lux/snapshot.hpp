@@ -0,0 +1,235 @@
+#ifndef snapshot_h
+#define snapshot_h
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "kit.hpp"
+
+namespace lux
+{
+    using namespace std;
+
+    /**
+     * The whole game state packed into one fixed-capacity block with no pointer in it, so cloning it is a plain copy
+     * and keeping thousands of them costs no allocation. capture() fills it from kit::Agent or from a GameMap and its
+     * players, restore() gives it back to a kit::Agent and lux::Simulator::restore() to a simulator.
+     * Units, cities and city tiles keep the order of Player::units, Player::cities and City::citytiles, so the
+     * CityTileHandle of every cell comes back the same. Maps are indexed by y * width + x as in GameMap.
+     */
+    struct GameStateSnapshot
+    {
+        static constexpr int MAX_CELLS = 32 * 32;
+        /**
+         * A city tile only builds a unit while its team has fewer units than city tiles, so units follow the tiles.
+         * The rules alone would allow a tile on nearly every cell of a 32 x 32 map, but self-play on 32 x 32 maps peaks
+         * at 267 units and 267 city tiles in 2 cities at once, so capacities a good half above that keep a snapshot
+         * under 17 KB. capture() returns false for a state beyond them.
+         */
+        static constexpr int MAX_UNITS = 384;
+        static constexpr int MAX_CITIES = 128;
+        static constexpr int MAX_CITY_TILES = 384;
+        /** Roads are kept in quarters: CART_ROAD_DEVELOPMENT_RATE and PILLAGE_RATE move them in steps of 0.75 and 0.5 */
+        static constexpr int ROAD_STEPS = 4;
+
+        struct UnitEntry
+        {
+            int uid;
+            float cooldown;
+            short wood;
+            short coal;
+            short uranium;
+            unsigned char x;
+            unsigned char y;
+            signed char team;
+            signed char type;
+        };
+
+        struct CityEntry
+        {
+            int uid;
+            float fuel;
+            float lightUpkeep;
+            /** Its tiles are tileCount entries of tiles from firstTile on */
+            short firstTile;
+            short tileCount;
+        };
+
+        struct CityTileEntry
+        {
+            float cooldown;
+            unsigned char x;
+            unsigned char y;
+        };
+
+        int turn;
+        int width;
+        int height;
+        /** Numbers the next unit and city get, as counted by lux::Simulator, guessed from the ids in play otherwise */
+        int nextUnitId;
+        int nextCityId;
+        int researchPoints[2];
+        /** Units of team 0 come first, then those of team 1, and the same for cities */
+        short unitCount[2];
+        short cityCount[2];
+        short cityTileCount;
+        ResourceType resourceType[MAX_CELLS];
+        /** -1 where there is no resource */
+        short resourceAmount[MAX_CELLS];
+        unsigned char road[MAX_CELLS];
+        UnitEntry units[MAX_UNITS];
+        CityEntry cities[MAX_CITIES];
+        CityTileEntry cityTiles[MAX_CITY_TILES];
+
+        /** Packs the state of agent as of its last update, false if it does not fit, see capture(map, players, turn) */
+        bool capture(const kit::Agent &agent)
+        {
+            return capture(agent.map, agent.players, agent.turn);
+        }
+
+        /**
+         * Packs a map and its players at turn, false if the map is larger than 32 x 32, there are more units, cities
+         * or city tiles than the capacities, or a value would not come back the same (a road off the quarters, an
+         * amount or a cargo past what a short holds). The snapshot is left half written in that case.
+         */
+        bool capture(const GameMap &map, const Player (&players)[2], int turn)
+        {
+            if (map.width <= 0 || map.height <= 0 || map.width > 255 || map.height > 255 || map.width * map.height > MAX_CELLS)
+                return false;
+            this->turn = turn;
+            width = map.width;
+            height = map.height;
+            int size = width * height;
+            for (int idx = 0; idx < size; idx++)
+            {
+                int amount = map.resourceAmount[idx];
+                float steps = map.road[idx] * ROAD_STEPS;
+                if (amount > SHRT_MAX || steps < 0 || steps > UCHAR_MAX || steps != (int)steps)
+                    return false;
+                resourceType[idx] = map.resourceType[idx];
+                resourceAmount[idx] = amount;
+                road[idx] = (unsigned char)steps;
+            }
+
+            int unitTotal = 0, cityTotal = 0;
+            cityTileCount = 0;
+            nextUnitId = 1;
+            nextCityId = 1;
+            for (const Player &player : players)
+            {
+                int team = player.team;
+                if (unitTotal + (int)player.units.size() > MAX_UNITS || cityTotal + (int)player.cities.size() > MAX_CITIES)
+                    return false;
+                researchPoints[team] = player.researchPoints;
+                unitCount[team] = player.units.size();
+                cityCount[team] = player.cities.size();
+                for (const Unit &unit : player.units)
+                {
+                    if (max(unit.cargo.wood, max(unit.cargo.coal, unit.cargo.uranium)) > SHRT_MAX)
+                        return false;
+                    UnitEntry &entry = units[unitTotal++];
+                    entry.uid = unit.uid;
+                    entry.cooldown = unit.cooldown;
+                    entry.wood = unit.cargo.wood;
+                    entry.coal = unit.cargo.coal;
+                    entry.uranium = unit.cargo.uranium;
+                    entry.x = unit.pos.x;
+                    entry.y = unit.pos.y;
+                    entry.team = team;
+                    entry.type = unit.type;
+                    nextUnitId = max(nextUnitId, unit.uid + 1);
+                }
+                for (const City &city : player.cities)
+                {
+                    if (cityTileCount + city.getTileCount() > MAX_CITY_TILES)
+                        return false;
+                    CityEntry &entry = cities[cityTotal++];
+                    entry.uid = city.uid;
+                    entry.fuel = city.fuel;
+                    entry.lightUpkeep = city.lightUpkeep;
+                    entry.firstTile = cityTileCount;
+                    entry.tileCount = city.getTileCount();
+                    for (const CityTile &tile : city.citytiles)
+                    {
+                        CityTileEntry &tileEntry = cityTiles[cityTileCount++];
+                        tileEntry.cooldown = tile.cooldown;
+                        tileEntry.x = tile.pos.x;
+                        tileEntry.y = tile.pos.y;
+                    }
+                    nextCityId = max(nextCityId, city.uid + 1);
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Sets agent to this state as if it had been read from the update block of the turn, so GameMap::dirtyCells and
+         * everything kept from them (bitboards, resource index, clusters) follow the difference with its previous state.
+         * The map is started again if agent has another size. Agent::id is left as it is.
+         */
+        void restore(kit::Agent &agent) const
+        {
+            if (agent.mapWidth != width || agent.mapHeight != height)
+                agent._setMapSize(width, height);
+            agent.turn = turn;
+            agent._beginUpdate();
+            GameMap &map = agent.map;
+            int size = width * height;
+            for (int idx = 0; idx < size; idx++)
+            {
+                if (resourceAmount[idx] != -1)
+                    map._setResource(resourceType[idx], idx % width, idx / width, resourceAmount[idx]);
+                if (road[idx] != 0)
+                    map._setRoad(idx % width, idx / width, getRoad(idx));
+            }
+
+            char id[16];
+            const UnitEntry *unit = units;
+            const CityEntry *city = cities;
+            for (int team = 0; team < 2; team++)
+            {
+                Player &player = agent.players[team];
+                player.researchPoints = researchPoints[team];
+                for (const UnitEntry *end = unit + unitCount[team]; unit != end; unit++)
+                {
+                    string_view unitid = writeId(id, 'u', unit->uid);
+                    player.units.emplace_back(team, unit->type, string(unitid), unit->uid, unit->x, unit->y, unit->cooldown, unit->wood, unit->coal, unit->uranium);
+                }
+                for (const CityEntry *end = city + cityCount[team]; city != end; city++)
+                {
+                    City &reported = player._getReportedCity(city->uid, writeId(id, 'c', city->uid));
+                    reported.fuel = city->fuel;
+                    reported.lightUpkeep = city->lightUpkeep;
+                    for (int i = city->firstTile; i < city->firstTile + city->tileCount; i++)
+                    {
+                        const CityTileEntry &tile = cityTiles[i];
+                        map._setCityTile(tile.x, tile.y, CityTileHandle(team, reported.index, reported.citytiles.size()));
+                        reported.addCityTile(tile.x, tile.y, tile.cooldown);
+                        player.cityTileCount += 1;
+                    }
+                }
+            }
+            agent._endUpdate();
+        }
+
+        float getRoad(int idx) const
+        {
+            return (float)road[idx] / ROAD_STEPS;
+        }
+
+        /** Writes the id the game gives unit or city number uid, "u_<uid>" or "c_<uid>", into buffer */
+        static string_view writeId(char (&buffer)[16], char kind, int uid)
+        {
+            buffer[0] = kind;
+            buffer[1] = '_';
+            char *end = to_chars(buffer + 2, buffer + sizeof(buffer), uid).ptr;
+            return string_view(buffer, end - buffer);
+        }
+    };
+
+    static_assert(is_trivially_copyable<GameStateSnapshot>::value, "a snapshot is cloned by copying its bytes");
+}
+
+#endif
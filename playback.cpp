@@ -0,0 +1,111 @@
+#include "bot.hpp"
+#include "lux/define.cpp"
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+/** Discards the strategy's debug output so playback runs at full speed */
+class NullBuffer : public streambuf
+{
+protected:
+  int overflow(int c) override
+  {
+    return c;
+  }
+};
+
+/**
+ * Feeds a recording made with LUX_RECORD=<prefix> through kit::Agent and the strategy, without the lux-ai-2021 CLI.
+ * usage: playback.out <recording.rec> [repeat]
+ * Built with -DLUX_COUNT_ALLOCATIONS it also reports the calls to the global operator new, and exits with 2 if any
+ * comes from the second half of the match, turns the buffers sized on the first turns must carry without allocating.
+ */
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    cerr << "usage: " << argv[0] << " <recording.rec> [repeat]" << endl;
+    return 1;
+  }
+  string stream;
+  int blocks;
+  if (!kit::Recorder::load(argv[1], stream, blocks) || blocks < 1)
+  {
+    cerr << "could not read recording " << argv[1] << endl;
+    return 1;
+  }
+  int repeat = argc > 2 ? max(1, atoi(argv[2])) : 1;
+  int turns = blocks - 1;
+
+  NullBuffer nullBuffer;
+  streambuf *stdoutBuffer = cout.rdbuf(&nullBuffer);
+
+  vector<double> updateTimes(turns, 0), turnTimes(turns, 0);
+  vector<size_t> turnAllocations(turns, 0);
+  size_t actionCount = 0;
+  for (int run = 0; run < repeat; run++)
+  {
+    kit::Agent gameState;
+    gameState.input = kit::InputReader(stream);
+    gameState.initialize();
+    Bot bot;
+
+    for (int turn = 0; turn < turns; turn++)
+    {
+      size_t turnStartAllocations = kit::allocationCount;
+      auto start = chrono::steady_clock::now();
+      gameState.update();
+      auto decoded = chrono::steady_clock::now();
+      kit::ActionList actions(gameState.arena.resource());
+      bot.playTurn(gameState, actions);
+      auto end = chrono::steady_clock::now();
+      turnAllocations[turn] += kit::allocationCount - turnStartAllocations;
+
+      updateTimes[turn] += chrono::duration<double, micro>(decoded - start).count();
+      turnTimes[turn] += chrono::duration<double, micro>(end - start).count();
+      actionCount += actions.size();
+    }
+  }
+  cout.rdbuf(stdoutBuffer);
+
+  double totalUpdate = 0, totalTurn = 0;
+  vector<int> slowest;
+  for (int turn = 0; turn < turns; turn++)
+  {
+    updateTimes[turn] /= repeat;
+    turnTimes[turn] /= repeat;
+    totalUpdate += updateTimes[turn];
+    totalTurn += turnTimes[turn];
+    slowest.push_back(turn);
+  }
+  sort(slowest.begin(), slowest.end(), [&](int a, int b)
+       { return turnTimes[a] > turnTimes[b]; });
+
+  cout << turns << " turns, " << repeat << " run(s), " << actionCount / repeat << " actions per run" << endl;
+  cout << "mean per turn: " << totalTurn / max(1, turns) << " us (update " << totalUpdate / max(1, turns) << " us)" << endl;
+#ifdef LUX_COUNT_ALLOCATIONS
+  // the first turns size the buffers that later turns reuse, so only the second half of the match counts as steady state
+  int steadyStart = GAME_PARAMETERS.MAX_DAYS / 2;
+  size_t steadyAllocations = 0;
+  for (int turn = steadyStart; turn < turns; turn++)
+  {
+    steadyAllocations += turnAllocations[turn];
+  }
+  cout << "operator new calls: " << accumulate(turnAllocations.begin(), turnAllocations.end(), (size_t)0) / repeat << " per run, "
+       << steadyAllocations / repeat << " from turn " << steadyStart << " on" << endl;
+#endif
+  cout << "slowest turns:" << endl;
+  for (int i = 0; i < min(turns, 5); i++)
+  {
+    cout << "  turn " << slowest[i] << ": " << turnTimes[slowest[i]] << " us (update " << updateTimes[slowest[i]] << " us)" << endl;
+  }
+#ifdef LUX_COUNT_ALLOCATIONS
+  if (steadyAllocations != 0)
+    return 2;
+#endif
+  return 0;
+}
@@ -0,0 +1,164 @@
+#include "bot.hpp"
+#include "lux/define.cpp"
+#include "lux/simulator.hpp"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+/** Discards the strategy's debug output */
+class NullBuffer : public streambuf
+{
+protected:
+  int overflow(int c) override
+  {
+    return c;
+  }
+};
+
+/** What one thread saw over the matches it played, merged once every thread is done */
+struct Totals
+{
+  int games = 0;
+  /** Matches won by team 0 and by team 1, the others were drawn */
+  int wins[2] = {};
+  /** City tiles when the match ended, at turn MAX_DAYS unless a team lost everything before */
+  long cityTiles[2] = {};
+  /** Matches that ended before turn MAX_DAYS */
+  int earlyEnds = 0;
+  long turns = 0;
+  /** Time each decision took, update() and playTurn() of one agent for one turn, in microseconds */
+  vector<float> latencies;
+};
+
+/** Plays one match of the strategy against itself on the map of seed and adds it to totals */
+void playMatch(uint32_t seed, int size, ostream &debug, Totals &totals)
+{
+  lux::Simulator sim;
+  sim.generate(seed, size, size);
+  kit::Agent agents[2];
+  Bot bots[2] = {Bot(debug), Bot(debug)};
+  string block, lines[2];
+  for (int team = 0; team < 2; team++)
+  {
+    block.clear();
+    sim.writeHeader(team, block);
+    agents[team].input = kit::InputReader(block);
+    agents[team].initialize();
+  }
+
+  while (!sim.isOver())
+  {
+    block.clear();
+    sim.writeState(block);
+    for (int team = 0; team < 2; team++)
+    {
+      agents[team].input.feed(block);
+      auto start = chrono::steady_clock::now();
+      agents[team].update();
+      kit::ActionList actions(agents[team].arena.resource());
+      bots[team].playTurn(agents[team], actions);
+      auto end = chrono::steady_clock::now();
+      totals.latencies.push_back(chrono::duration<float, micro>(end - start).count());
+
+      lines[team].clear();
+      for (size_t i = 0; i < actions.size(); i++)
+      {
+        if (i != 0)
+          lines[team] += ',';
+        lines[team] += actions[i];
+      }
+    }
+    string_view commands[2] = {lines[0], lines[1]};
+    sim.step(commands);
+    totals.turns++;
+  }
+
+  totals.games++;
+  if (sim.turn < GAME_PARAMETERS.MAX_DAYS)
+    totals.earlyEnds++;
+  int leader = sim.getLeader();
+  if (leader != -1)
+    totals.wins[leader]++;
+  for (int team = 0; team < 2; team++)
+  {
+    totals.cityTiles[team] += sim.players[team].cityTileCount;
+  }
+}
+
+float percentile(vector<float> &values, double p)
+{
+  if (values.empty())
+    return 0;
+  size_t k = min(values.size() - 1, (size_t)(p * values.size()));
+  nth_element(values.begin(), values.begin() + k, values.end());
+  return values[k];
+}
+
+/**
+ * Plays seeded matches of the strategy against itself with lux::Simulator, spread over threads that each own their
+ * simulator, agents and strategies, and reports the results and how long the decisions took.
+ * usage: selfplay.out [games] [threads] [first seed] [map size]
+ * Match i is played on the map of seed first + i, 12, 16, 24 or 32 cells wide in turn unless a map size is given.
+ */
+int main(int argc, char **argv)
+{
+  int games = argc > 1 ? max(1, atoi(argv[1])) : 1000;
+  int threadCount = argc > 2 ? max(1, atoi(argv[2])) : max(1, (int)thread::hardware_concurrency());
+  uint32_t firstSeed = argc > 3 ? (uint32_t)strtoul(argv[3], nullptr, 10) : 1;
+  int fixedSize = argc > 4 ? atoi(argv[4]) : 0;
+  const int sizes[4] = {12, 16, 24, 32};
+
+  atomic<int> nextGame{0};
+  vector<Totals> totals(threadCount);
+  vector<thread> threads;
+  auto start = chrono::steady_clock::now();
+  for (int t = 0; t < threadCount; t++)
+  {
+    threads.emplace_back([&, t]
+                         {
+                           NullBuffer nullBuffer;
+                           ostream debug(&nullBuffer);
+                           // a stream in a failed state skips the formatting too
+                           debug.setstate(ios::badbit);
+                           for (int game = nextGame++; game < games; game = nextGame++)
+                           {
+                             playMatch(firstSeed + game, fixedSize > 0 ? fixedSize : sizes[game % 4], debug, totals[t]);
+                           } });
+  }
+  for (thread &worker : threads)
+  {
+    worker.join();
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  Totals all;
+  for (Totals &part : totals)
+  {
+    all.games += part.games;
+    all.turns += part.turns;
+    all.earlyEnds += part.earlyEnds;
+    for (int team = 0; team < 2; team++)
+    {
+      all.wins[team] += part.wins[team];
+      all.cityTiles[team] += part.cityTiles[team];
+    }
+    all.latencies.insert(all.latencies.end(), part.latencies.begin(), part.latencies.end());
+  }
+
+  int draws = all.games - all.wins[0] - all.wins[1];
+  cout << all.games << " games on " << threadCount << " thread(s) in " << seconds << " s: "
+       << all.games / seconds << " games/s, " << all.turns / seconds << " turns/s" << endl;
+  cout << "wins: team 0 " << 100.0 * all.wins[0] / all.games << "%, team 1 " << 100.0 * all.wins[1] / all.games
+       << "%, draws " << 100.0 * draws / all.games << "%" << endl;
+  cout << "mean city tiles at turn " << GAME_PARAMETERS.MAX_DAYS << ": team 0 " << (double)all.cityTiles[0] / all.games << ", team 1 "
+       << (double)all.cityTiles[1] / all.games << " (the final state of the " << all.earlyEnds << " games that ended earlier)" << endl;
+  cout << "decision latency (us): p50 " << percentile(all.latencies, 0.5) << ", p90 " << percentile(all.latencies, 0.9)
+       << ", p99 " << percentile(all.latencies, 0.99) << ", max " << percentile(all.latencies, 1.0) << endl;
+  return 0;
+}
@@ -0,0 +1,214 @@
+#include "lux/kit.hpp"
+#include "lux/define.cpp"
+#include "lux/simulator.hpp"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+using namespace std;
+
+/** Splits text into its lines, sorted, so two blocks compare whatever order their lines came in */
+static vector<string_view> sortedLines(string_view text)
+{
+  vector<string_view> lines;
+  kit::Tokenizer tokens(text, '\n');
+  while (!tokens.done())
+  {
+    string_view line = tokens.next();
+    if (!line.empty())
+      lines.push_back(line);
+  }
+  sort(lines.begin(), lines.end());
+  return lines;
+}
+
+/** Compares a simulated update block with the expected one, printing up to 10 lines of each side that the other lacks if print */
+static bool sameBlock(string_view expectedBlock, string_view simulatedBlock, bool print)
+{
+  vector<string_view> expected = sortedLines(expectedBlock);
+  vector<string_view> actual = sortedLines(simulatedBlock);
+  vector<string_view> missing, extra;
+  set_difference(expected.begin(), expected.end(), actual.begin(), actual.end(), back_inserter(missing));
+  set_difference(actual.begin(), actual.end(), expected.begin(), expected.end(), back_inserter(extra));
+  if (missing.empty() && extra.empty())
+    return true;
+  if (print)
+  {
+    for (size_t i = 0; i < min(missing.size(), (size_t)10); i++)
+      cout << "  expected  " << missing[i] << endl;
+    for (size_t i = 0; i < min(extra.size(), (size_t)10); i++)
+      cout << "  simulated " << extra[i] << endl;
+  }
+  return false;
+}
+
+/**
+ * Runs the rule cases of a file shaped like simcheck_cases.txt: every state is loaded, played one turn with the
+ * commands of both teams and compared with the state the case expects. Returns the number of cases that differ, -1
+ * if the file cannot be read.
+ */
+static int checkCases(const char *path)
+{
+  ifstream file(path);
+  if (!file)
+  {
+    cerr << "could not read cases " << path << endl;
+    return -1;
+  }
+  string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+  kit::Tokenizer lines(text, '\n');
+  string name, state, expected, commands[2];
+  int width = 0, height = 0, turn = 0, cases = 0, failed = 0;
+  // the state block comes first, then the commands, then the expected block
+  string *block = nullptr;
+  while (!lines.done())
+  {
+    string_view line = lines.next();
+    if (block == nullptr && (line.empty() || line[0] == '#'))
+      continue;
+    kit::Tokenizer parts(line);
+    string_view kind = parts.next();
+    if (block != nullptr)
+    {
+      block->append(line);
+      block->push_back('\n');
+      if (line != kit::INPUT_CONSTANTS::DONE)
+        continue;
+      if (block == &state)
+      {
+        block = nullptr;
+        continue;
+      }
+      block = nullptr;
+      lux::Simulator sim;
+      sim.load(state, width, height, turn);
+      string_view views[2] = {commands[0], commands[1]};
+      sim.step(views);
+      string simulated;
+      sim.writeState(simulated);
+      cases++;
+      if (sameBlock(expected, simulated, false))
+        continue;
+      failed++;
+      cout << "case " << name << ":" << endl;
+      sameBlock(expected, simulated, true);
+    }
+    else if (kind == "case")
+    {
+      name = line.substr(kind.size() + 1);
+      commands[0].clear();
+      commands[1].clear();
+    }
+    else if (kind == "map")
+    {
+      width = parts.nextInt();
+      height = parts.nextInt();
+      turn = parts.nextInt();
+      state.clear();
+      block = &state;
+    }
+    else if (kind == "commands")
+    {
+      int team = parts.nextInt();
+      // the list follows "commands <team> " and is left out when the team gives no command
+      size_t start = kind.size() + 3;
+      commands[team] = line.size() > start ? line.substr(start) : string_view();
+      if (team == 1)
+      {
+        expected.clear();
+        block = &expected;
+      }
+    }
+  }
+  cout << cases << " cases checked, " << failed << " with differences" << endl;
+  return failed;
+}
+
+/**
+ * Checks lux::Simulator against a match played by the lux-ai-2021 CLI: the recording one agent made with LUX_RECORD=<prefix>
+ * gives the state of every turn, the replay file written with --out gives the commands of both agents.
+ * Every turn is simulated from the recorded state and compared with the next recorded state, line by line.
+ * Given a single file, runs the rule cases in it instead, see simcheck_cases.txt.
+ * usage: simcheck.out <recording.rec> <replay.json> | simcheck.out <cases.txt>
+ */
+int main(int argc, char **argv)
+{
+  if (argc == 2)
+  {
+    int failed = checkCases(argv[1]);
+    return failed < 0 ? 1 : (failed == 0 ? 0 : 2);
+  }
+  if (argc < 3)
+  {
+    cerr << "usage: " << argv[0] << " <recording.rec> <replay.json> | " << argv[0] << " <cases.txt>" << endl;
+    return 1;
+  }
+  string stream;
+  int blocks;
+  if (!kit::Recorder::load(argv[1], stream, blocks) || blocks < 2)
+  {
+    cerr << "could not read recording " << argv[1] << endl;
+    return 1;
+  }
+  ifstream replayFile(argv[2]);
+  if (!replayFile)
+  {
+    cerr << "could not read replay " << argv[2] << endl;
+    return 1;
+  }
+  nlohmann::json replay = nlohmann::json::parse(replayFile);
+  const nlohmann::json &allCommands = replay["allCommands"];
+
+  kit::InputReader input(stream);
+  input.getline();
+  kit::Tokenizer size(input.getline());
+  int width = size.nextInt();
+  int height = size.nextInt();
+  vector<string> states;
+  for (int turn = 0; turn < blocks - 1; turn++)
+  {
+    input.readBlock();
+    states.emplace_back(input.block());
+    for (string_view line = input.getline(); line != kit::INPUT_CONSTANTS::DONE; line = input.getline())
+    {
+    }
+  }
+
+  lux::Simulator sim;
+  int turns = min((int)states.size() - 1, (int)allCommands.size());
+  int mismatchedTurns = 0, rejected = 0;
+  int nextUnitId = 1, nextCityId = 1;
+  for (int turn = 0; turn < turns; turn++)
+  {
+    string commands[2];
+    for (const nlohmann::json &entry : allCommands[turn])
+    {
+      int agent = entry["agentID"].get<int>();
+      if (!commands[agent].empty())
+        commands[agent] += ',';
+      commands[agent] += entry["command"].get<string>();
+    }
+    // every turn starts again from the recorded state, so one difference does not spread to the turns after it
+    sim.load(states[turn], width, height, turn);
+    // ids of units and cities gone since are not in the state any more, the counters only ever grow
+    nextUnitId = sim.nextUnitId = max(nextUnitId, sim.nextUnitId);
+    nextCityId = sim.nextCityId = max(nextCityId, sim.nextCityId);
+    string_view views[2] = {commands[0], commands[1]};
+    sim.step(views);
+    rejected += sim.rejectedCommands;
+
+    string simulated;
+    sim.writeState(simulated);
+    if (sameBlock(states[turn + 1], simulated, false))
+      continue;
+    if (mismatchedTurns++ < 5)
+    {
+      cout << "turn " << turn << " -> " << turn + 1 << ":" << endl;
+      sameBlock(states[turn + 1], simulated, true);
+    }
+  }
+  cout << turns << " turns checked, " << mismatchedTurns << " with differences, " << rejected << " commands rejected" << endl;
+  return mismatchedTurns == 0 ? 0 : 2;
+}
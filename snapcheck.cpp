@@ -0,0 +1,240 @@
+#include "bot.hpp"
+#include "lux/define.cpp"
+#include "lux/simulator.hpp"
+#include "lux/snapshot.hpp"
+#include <vector>
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+/** Discards the strategy's debug output */
+class NullBuffer : public streambuf
+{
+protected:
+  int overflow(int c) override
+  {
+    return c;
+  }
+};
+
+/** Whether two snapshots hold the same state, comparing only the cells, units, cities and city tiles in use */
+static bool sameState(const lux::GameStateSnapshot &a, const lux::GameStateSnapshot &b)
+{
+  if (a.turn != b.turn || a.width != b.width || a.height != b.height || a.nextUnitId != b.nextUnitId || a.nextCityId != b.nextCityId ||
+      a.cityTileCount != b.cityTileCount)
+    return false;
+  for (int team = 0; team < 2; team++)
+  {
+    if (a.researchPoints[team] != b.researchPoints[team] || a.unitCount[team] != b.unitCount[team] || a.cityCount[team] != b.cityCount[team])
+      return false;
+  }
+  for (int idx = 0; idx < a.width * a.height; idx++)
+  {
+    if (a.resourceAmount[idx] != b.resourceAmount[idx] || a.road[idx] != b.road[idx] ||
+        (a.resourceAmount[idx] != -1 && a.resourceType[idx] != b.resourceType[idx]))
+      return false;
+  }
+  for (int i = 0; i < a.unitCount[0] + a.unitCount[1]; i++)
+  {
+    const lux::GameStateSnapshot::UnitEntry &u = a.units[i], &v = b.units[i];
+    if (u.uid != v.uid || u.cooldown != v.cooldown || u.wood != v.wood || u.coal != v.coal || u.uranium != v.uranium ||
+        u.x != v.x || u.y != v.y || u.team != v.team || u.type != v.type)
+      return false;
+  }
+  for (int i = 0; i < a.cityCount[0] + a.cityCount[1]; i++)
+  {
+    const lux::GameStateSnapshot::CityEntry &c = a.cities[i], &d = b.cities[i];
+    if (c.uid != d.uid || c.fuel != d.fuel || c.lightUpkeep != d.lightUpkeep || c.firstTile != d.firstTile || c.tileCount != d.tileCount)
+      return false;
+  }
+  for (int i = 0; i < a.cityTileCount; i++)
+  {
+    const lux::GameStateSnapshot::CityTileEntry &t = a.cityTiles[i], &s = b.cityTiles[i];
+    if (t.cooldown != s.cooldown || t.x != s.x || t.y != s.y)
+      return false;
+  }
+  return true;
+}
+
+/** What differs between the map and the structures kept from it of two agents, empty if nothing does */
+static string agentDifference(const kit::Agent &a, const kit::Agent &b)
+{
+  if (a.mapWidth != b.mapWidth || a.mapHeight != b.mapHeight)
+    return "map size";
+  const lux::GameMap &m = a.map, &n = b.map;
+  if (m.resourceAmount != n.resourceAmount || m.road != n.road || m.citytileTeam != n.citytileTeam || m.citytileCity != n.citytileCity ||
+      m.citytileIndex != n.citytileIndex)
+    return "map layers";
+  const lux::BitboardLayers &p = a.bitboards, &q = b.bitboards;
+  if (p.units[0] != q.units[0] || p.units[1] != q.units[1] || p.citytiles[0] != q.citytiles[0] || p.citytiles[1] != q.citytiles[1] ||
+      p.wood != q.wood || p.coal != q.coal || p.uranium != q.uranium || p.roads != q.roads)
+    return "bitboards";
+
+  const int weights[lux::ResourceIndex::TYPE_COUNT] = {1, 1, 1};
+  const lux::ResourceType types[lux::ResourceIndex::TYPE_COUNT] = {lux::ResourceType::wood, lux::ResourceType::coal, lux::ResourceType::uranium};
+  for (lux::ResourceType type : types)
+  {
+    if (a.resourceIndex.count(type) != b.resourceIndex.count(type))
+      return "resource index counts";
+  }
+  for (int y = 0; y < a.mapHeight; y++)
+  {
+    for (int x = 0; x < a.mapWidth; x++)
+    {
+      lux::Position pos(x, y);
+      if (a.resourceIndex.findNearest(pos, m, weights, 0, lux::Bitboard()) != b.resourceIndex.findNearest(pos, n, weights, 0, lux::Bitboard()))
+        return "resource index at " + to_string(x) + " " + to_string(y);
+
+      // roots depend on the order cells joined, so clusters are compared by what they hold
+      int id = a.clusters.getClusterId(x, y), other = b.clusters.getClusterId(x, y);
+      if ((id == -1) != (other == -1))
+        return "cluster membership at " + to_string(x) + " " + to_string(y);
+      if (id == -1)
+        continue;
+      const lux::ResourceCluster &c = a.clusters.get(id), &d = b.clusters.get(other);
+      if (c.type != d.type || c.cellCount != d.cellCount || c.amount != d.amount || c.fuel != d.fuel || c.centroid != d.centroid ||
+          c.cells != d.cells || c.perimeter != d.perimeter)
+        return "cluster at " + to_string(x) + " " + to_string(y);
+    }
+  }
+  if (a.clusters.getIds().size() != b.clusters.getIds().size())
+    return "cluster count";
+  return "";
+}
+
+/**
+ * Checks lux::GameStateSnapshot on the mid-game states of seeded self-play matches over lux::Simulator.
+ * Every turn: the simulator is saved, restored into a second simulator and saved again, and both saves and update
+ * blocks must be the same; each agent is captured, restored into an agent that follows it only through snapshots and
+ * captured again, and the two captures, maps, bitboards, resource indices and clusters must be the same.
+ * At the middle of every match the state is also restored into one agent kept across matches, so it always arrives
+ * from a map of another size, 32 x 32 before a 12 x 12 included.
+ * Built with -DLUX_COUNT_ALLOCATIONS it also checks that restoring a simulator to a state it already had room for
+ * allocates nothing, and neither does any step of the second half of a match, once the first half has sized the buffers.
+ * usage: snapcheck.out [games] [first seed]
+ * Match i is played on the map of seed first + i, 12, 16, 24 or 32 cells wide in turn.
+ */
+int main(int argc, char **argv)
+{
+  int games = argc > 1 ? max(1, atoi(argv[1])) : 8;
+  uint32_t firstSeed = argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 1;
+  const int sizes[4] = {12, 16, 24, 32};
+
+  NullBuffer nullBuffer;
+  ostream debug(&nullBuffer);
+  debug.setstate(ios::badbit);
+
+  // too large for the stack many times over
+  static lux::GameStateSnapshot saved, again;
+  kit::Agent crossed;
+  int turns = 0, failures = 0, oversized = 0, crossings = 0;
+#ifdef LUX_COUNT_ALLOCATIONS
+  size_t restoreAllocations = 0, stepAllocations = 0;
+#endif
+  auto fail = [&](uint32_t seed, int turn, const string &what)
+  {
+    if (failures++ < 10)
+      cout << "seed " << seed << " turn " << turn << ": " << what << endl;
+  };
+
+  for (int game = 0; game < games; game++)
+  {
+    uint32_t seed = firstSeed + game;
+    int size = sizes[game % 4];
+    lux::Simulator sim, restored;
+    sim.generate(seed, size, size);
+    kit::Agent agents[2], mirrors[2];
+    Bot bots[2] = {Bot(debug), Bot(debug)};
+    string block, lines[2], restoredBlock;
+    for (int team = 0; team < 2; team++)
+    {
+      block.clear();
+      sim.writeHeader(team, block);
+      agents[team].input = kit::InputReader(block);
+      agents[team].initialize();
+      mirrors[team].id = team;
+    }
+
+    while (!sim.isOver())
+    {
+      turns++;
+      if (!sim.save(saved))
+      {
+        oversized++;
+        break;
+      }
+      restored.restore(saved);
+      restored.save(again);
+      block.clear();
+      sim.writeState(block);
+      restoredBlock.clear();
+      restored.writeState(restoredBlock);
+      if (!sameState(saved, again) || block != restoredBlock)
+        fail(seed, sim.turn, "simulator restore");
+#ifdef LUX_COUNT_ALLOCATIONS
+      size_t before = kit::allocationCount;
+      restored.restore(saved);
+      restoreAllocations += kit::allocationCount - before;
+#endif
+
+      for (int team = 0; team < 2; team++)
+      {
+        kit::Agent &agent = agents[team];
+        agent.input.feed(block);
+        agent.update();
+        if (!saved.capture(agent))
+        {
+          oversized++;
+          continue;
+        }
+        saved.restore(mirrors[team]);
+        again.capture(mirrors[team]);
+        if (!sameState(saved, again))
+          fail(seed, agent.turn, "agent capture after restore");
+        string difference = agentDifference(agent, mirrors[team]);
+        if (!difference.empty())
+          fail(seed, agent.turn, "agent restore: " + difference);
+
+        if (team == 0 && sim.turn == GAME_PARAMETERS.MAX_DAYS / 2)
+        {
+          crossings++;
+          saved.restore(crossed);
+          difference = agentDifference(agent, crossed);
+          if (!difference.empty())
+            fail(seed, agent.turn, "restore from another map size: " + difference);
+        }
+
+        kit::ActionList actions(agent.arena.resource());
+        bots[team].playTurn(agent, actions);
+        lines[team].clear();
+        for (size_t i = 0; i < actions.size(); i++)
+        {
+          if (i != 0)
+            lines[team] += ',';
+          lines[team] += actions[i];
+        }
+      }
+      string_view commands[2] = {lines[0], lines[1]};
+#ifdef LUX_COUNT_ALLOCATIONS
+      before = kit::allocationCount;
+      int steppedTurn = sim.turn;
+#endif
+      sim.step(commands);
+#ifdef LUX_COUNT_ALLOCATIONS
+      if (steppedTurn >= GAME_PARAMETERS.MAX_DAYS / 2)
+        stepAllocations += kit::allocationCount - before;
+#endif
+    }
+  }
+
+  cout << games << " matches, " << turns << " turns checked, " << crossings << " restores from another map size, "
+       << failures << " failures, " << oversized << " states over the capacities" << endl;
+#ifdef LUX_COUNT_ALLOCATIONS
+  cout << "operator new calls restoring a simulator to a state it had room for: " << restoreAllocations << endl;
+  cout << "operator new calls stepping the simulator from turn " << GAME_PARAMETERS.MAX_DAYS / 2 << " on: " << stepAllocations << endl;
+  if (restoreAllocations != 0 || stepAllocations != 0)
+    failures++;
+#endif
+  return failures == 0 ? 0 : 2;
+}